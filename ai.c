@@ -0,0 +1,347 @@
+#include "ai.h"
+#include <stdlib.h>
+#include <string.h>
+#include "sleep.h"
+
+/* Score of a won position; faster wins score higher. */
+#define WIN_SCORE 100000
+#define INFINITE_SCORE (WIN_SCORE + 1)
+
+/* Penalty for leaving the opponent aimed at us. */
+#define THREAT_SCORE 500
+
+/* Bonus for every direction from which a tank could hit the other one. */
+#define AIM_SCORE 40
+
+/* Kinds of transposition table bounds. */
+#define BOUND_EXACT 0
+#define BOUND_LOWER 1
+#define BOUND_UPPER 2
+
+/* Number of entries in the cache of laser shot results. */
+#define BEAMS_SIZE (1U << 16)
+
+/* Moves tried by the search, in default order. */
+static const char MOVES[] = {'u', 'd', 'l', 'r', ACTION_NONE};
+#define MOVE_COUNT ((int) sizeof(MOVES))
+
+/* Mixes the bits of a 64-bit integer (splitmix64 finalizer). */
+static unsigned long long mix(unsigned long long h)
+{
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBULL;
+    h ^= h >> 31;
+    return h;
+}
+
+/* Hashes a game state together with the tank to move. */
+static unsigned long long hash_state(unsigned long long ai_salt, const game_state_t* state, int side)
+{
+    unsigned long long h;
+    int t;
+
+    h = ai_salt ^ ((unsigned long long) side + 1);
+    for (t = 0; t < 2; t++)
+    {
+        h = mix(h ^ (unsigned long long) (unsigned) state->tanks[t].pos.x);
+        h = mix(h ^ (unsigned long long) (unsigned) state->tanks[t].pos.y);
+        h = mix(h ^ (unsigned long long) (unsigned char) state->tanks[t].dir);
+    }
+    return h;
+}
+
+/* state_shot_hits, memoized: the result only depends on the two tank
+positions and the laser direction since the mirrors never move. Cheap
+already, but evaluate asks the same questions over and over. */
+static bool shot_hits(ai_t* ai, const board_t* board, const game_state_t* state,
+int shooter, char dir)
+{
+    unsigned long long key;
+    beam_entry_t* entry;
+    const tank_t* self;
+    const tank_t* other;
+
+    self = &state->tanks[shooter];
+    other = &state->tanks[1 - shooter];
+    key = mix(ai->salt ^ (unsigned long long) (unsigned) self->pos.x);
+    key = mix(key ^ (unsigned long long) (unsigned) self->pos.y);
+    key = mix(key ^ (unsigned long long) (unsigned) other->pos.x);
+    key = mix(key ^ (unsigned long long) (unsigned) other->pos.y);
+    key = mix(key ^ (unsigned long long) (unsigned char) dir);
+    key |= 1;   /* Zero marks an empty entry. */
+
+    entry = &ai->beams[key & (ai->beams_size - 1)];
+    if (entry->key != key)
+    {
+        entry->key = key;
+        entry->hits = state_shot_hits(board, state, shooter, dir);
+    }
+    return entry->hits;
+}
+
+/* Static evaluation of a quiet position from the point of view of side. */
+static int evaluate(ai_t* ai, const board_t* board, const game_state_t* state, int side)
+{
+    static const char DIRS[] = {'u', 'd', 'l', 'r'};
+    int score;
+    int d;
+
+    score = 0;
+
+    /* Being aimed at means having to get out of the way next turn. */
+    if (shot_hits(ai, board, state, 1 - side, state->tanks[1 - side].dir))
+    {
+        score -= THREAT_SCORE;
+    }
+
+    /* Prefer positions with more ways to hit than to be hit. */
+    for (d = 0; d < 4; d++)
+    {
+        if (shot_hits(ai, board, state, side, DIRS[d]))
+        {
+            score += AIM_SCORE;
+        }
+        if (shot_hits(ai, board, state, 1 - side, DIRS[d]))
+        {
+            score -= AIM_SCORE;
+        }
+    }
+    return score;
+}
+
+/* Returns true if a score is that of a won or lost position. */
+static bool is_win_score(const ai_t* ai, int score)
+{
+    return score >= WIN_SCORE - ai->max_depth || score <= -WIN_SCORE + ai->max_depth;
+}
+
+/* Converts a score found ply plies from the root into the one kept in the
+transposition table, where wins count plies from the stored node. */
+static int score_to_table(const ai_t* ai, int score, int ply)
+{
+    if (!is_win_score(ai, score))
+    {
+        return score;
+    }
+    return score > 0 ? score + ply : score - ply;
+}
+
+/* Converts a score kept in the transposition table back into one counting
+plies from the root, for a node ply plies from it. */
+static int score_from_table(const ai_t* ai, int score, int ply)
+{
+    if (!is_win_score(ai, score))
+    {
+        return score;
+    }
+    return score > 0 ? score - ply : score + ply;
+}
+
+/* Negamax alpha-beta search; returns the score of state for side. */
+static int search(ai_t* ai, const board_t* board, const game_state_t* state,
+int side, int depth, int ply, int alpha, int beta, char* best_action)
+{
+    unsigned long long key;
+    tt_entry_t* entry;
+    int original_alpha;
+    int best_score;
+    int table_score;
+    char best;
+    char hint;
+    int i;
+
+    /* Stay within the time budget; the caller discards aborted searches. */
+    if (ai->aborted || usec_now() >= ai->deadline)
+    {
+        ai->aborted = true;
+        return 0;
+    }
+    ai->nodes++;
+
+    /* Firing when aimed at the other tank wins on the spot. */
+    if (shot_hits(ai, board, state, side, state->tanks[side].dir))
+    {
+        *best_action = ACTION_FIRE;
+        return WIN_SCORE - ply;
+    }
+    if (depth == 0)
+    {
+        *best_action = ACTION_NONE;
+        return evaluate(ai, board, state, side);
+    }
+
+    /* Probe the transposition table. */
+    key = hash_state(ai->salt, state, side);
+    entry = &ai->table[key & (ai->table_size - 1)];
+    hint = ACTION_NONE;
+    if (entry->key == key)
+    {
+        hint = entry->best;
+        table_score = score_from_table(ai, entry->score, ply);
+        if (entry->depth >= depth && ply > 0)
+        {
+            if (entry->bound == BOUND_EXACT
+            || (entry->bound == BOUND_LOWER && table_score >= beta)
+            || (entry->bound == BOUND_UPPER && table_score <= alpha))
+            {
+                *best_action = entry->best;
+                return table_score;
+            }
+        }
+    }
+
+    original_alpha = alpha;
+    best_score = -INFINITE_SCORE;
+    best = hint;
+
+    /* Try the move suggested by the table first, then the others. */
+    for (i = -1; i < MOVE_COUNT; i++)
+    {
+        game_state_t child;
+        char action, reply;
+        int score;
+
+        action = i < 0 ? hint : MOVES[i];
+        if (i >= 0 && action == hint)
+        {
+            continue;
+        }
+
+        child = *state;
+        if (action != ACTION_NONE)
+        {
+            state_go_or_face(board, &child, side, action);
+        }
+        score = -search(ai, board, &child, 1 - side, depth - 1, ply + 1,
+        -beta, -alpha, &reply);
+        if (ai->aborted)
+        {
+            return 0;
+        }
+
+        if (score > best_score)
+        {
+            best_score = score;
+            best = action;
+        }
+        if (score > alpha)
+        {
+            alpha = score;
+        }
+        if (alpha >= beta)
+        {
+            break;
+        }
+    }
+
+    /* Store the result. */
+    entry->key = key;
+    entry->score = score_to_table(ai, best_score, ply);
+    entry->depth = (short) depth;
+    entry->best = best;
+    if (best_score <= original_alpha)
+    {
+        entry->bound = BOUND_UPPER;
+    }
+    else if (best_score >= beta)
+    {
+        entry->bound = BOUND_LOWER;
+    }
+    else
+    {
+        entry->bound = BOUND_EXACT;
+    }
+
+    *best_action = best;
+    return best_score;
+}
+
+void create_ai(ai_t* ai, size_t table_size, int max_depth)
+{
+    size_t size;
+
+    /* Round the table size down to a power of two. */
+    for (size = 1; size * 2 <= table_size; size *= 2);
+
+    /* Touch every page now so that no decision pays for page faults. */
+    ai->table = malloc(size * sizeof(tt_entry_t));
+    memset(ai->table, 0, size * sizeof(tt_entry_t));
+    ai->table_size = size;
+    ai->beams = malloc(BEAMS_SIZE * sizeof(beam_entry_t));
+    memset(ai->beams, 0, BEAMS_SIZE * sizeof(beam_entry_t));
+    ai->beams_size = BEAMS_SIZE;
+    ai->board = NULL;
+    ai->salt = 0;
+    ai->deadline = 0;
+    ai->aborted = false;
+    ai->max_depth = max_depth;
+    ai->depth_reached = 0;
+    ai->nodes = 0;
+}
+
+void free_ai(ai_t* ai)
+{
+    free(ai->table);
+    free(ai->beams);
+    ai->table = NULL;
+    ai->beams = NULL;
+}
+
+void clear_ai(ai_t* ai)
+{
+    /* Rather than wiping the tables, salt every key differently from now
+    on; stale entries then simply never match. */
+    ai->salt = mix(ai->salt + 1);
+}
+
+char ai_choose_action(ai_t* ai, const board_t* board, const game_state_t* state,
+int tank, long budget_usec)
+{
+    char best;
+    int depth;
+
+    /* Results computed for another board are meaningless here. */
+    if (ai->board != board)
+    {
+        clear_ai(ai);
+        ai->board = board;
+    }
+
+    ai->deadline = usec_now() + budget_usec;
+    ai->aborted = false;
+    ai->depth_reached = 0;
+    ai->nodes = 0;
+
+    /* Take a sure hit without searching. */
+    if (shot_hits(ai, board, state, tank, state->tanks[tank].dir))
+    {
+        return ACTION_FIRE;
+    }
+
+    /* Iterative deepening: keep the result of the deepest search that
+    completed within the budget. */
+    best = ACTION_NONE;
+    for (depth = 1; depth <= ai->max_depth; depth++)
+    {
+        char action;
+        int score;
+
+        score = search(ai, board, state, tank, depth, 0,
+        -INFINITE_SCORE, INFINITE_SCORE, &action);
+        if (ai->aborted)
+        {
+            break;
+        }
+        best = action;
+        ai->depth_reached = depth;
+
+        /* A forced result won't change with more depth. */
+        if (is_win_score(ai, score))
+        {
+            break;
+        }
+    }
+    return best;
+}
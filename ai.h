@@ -0,0 +1,87 @@
+#ifndef AI_H
+#define AI_H
+#include <stddef.h>
+#include "state.h"
+
+/* Search-based tank controller.
+ *
+ * Actions are the directions u/d/l/r (go or face, like the go_or_face_*
+ * functions), f (fire) and n (do nothing). The controller runs an
+ * iterative-deepening alpha-beta (negamax) search over game_state_t and
+ * returns the best action of the deepest search that completed within
+ * the time budget. */
+
+/** Action of a tank which does nothing this turn. */
+#define ACTION_NONE 'n'
+
+/** Action of a tank which fires its laser. */
+#define ACTION_FIRE 'f'
+
+/** Defines an entry of the transposition table. */
+typedef struct
+{
+    unsigned long long key;
+    int score;
+    short depth;
+    char bound;     /* Whether score is exact, a lower or an upper bound. */
+    char best;      /* Best action found for the position. */
+} tt_entry_t;
+
+/** Defines an entry of the cache of laser shot results. */
+typedef struct
+{
+    unsigned long long key;
+    bool hits;
+} beam_entry_t;
+
+/** Defines the state of a search-based controller. An ai_t is not
+ * shared between threads; create one per thread instead. */
+typedef struct
+{
+    tt_entry_t* table;
+    size_t table_size;      /* Power of two. */
+    beam_entry_t* beams;
+    size_t beams_size;      /* Power of two. */
+
+    /* Board the cached results were computed for, and a salt mixed into
+    every key, changed whenever the cached results become stale. */
+    const board_t* board;
+    unsigned long long salt;
+
+    /* Search limits and bookkeeping. */
+    long long deadline;     /* In microseconds, see usec_now. */
+    bool aborted;
+    int max_depth;
+
+    /* Statistics of the most recent call to ai_choose_action. */
+    int depth_reached;
+    long nodes;
+} ai_t;
+
+/** Prepares a controller.
+ * @param ai controller to prepare.
+ * @param table_size number of entries of the transposition table,
+ * rounded down to a power of two.
+ * @param max_depth maximum search depth in plies. */
+void create_ai(ai_t* ai, size_t table_size, int max_depth);
+
+/** Frees heap memory associated with a controller.
+ * @param ai controller to free. */
+void free_ai(ai_t* ai);
+
+/** Forgets everything a controller learnt about a board. Call this after
+ * the mirrors of the board it plays on change.
+ * @param ai controller prepared by create_ai. */
+void clear_ai(ai_t* ai);
+
+/** Picks the next action of a tank.
+ * @param ai controller prepared by create_ai.
+ * @param board board of the game.
+ * @param state current game state.
+ * @param tank index of the tank to move (TANK_PLAYER or TANK_ENEMY).
+ * @param budget_usec time budget of the decision in microseconds.
+ * @return one of u/d/l/r, ACTION_FIRE or ACTION_NONE. */
+char ai_choose_action(ai_t* ai, const board_t* board, const game_state_t* state,
+int tank, long budget_usec);
+
+#endif  /* AI_H */
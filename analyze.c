@@ -0,0 +1,608 @@
+#define _POSIX_C_SOURCE 200809L
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "sleep.h"
+#include "utils.h"
+
+/* Kinds of heatmaps collected from the logs. */
+#define HEATMAP_OCCUPANCY 0     /* Frames in which a tank is on the cell. */
+#define HEATMAP_BEAMS 1         /* Frames in which a laser beam is on the cell. */
+#define HEATMAP_MIRROR_HITS 2   /* Laser beams turned by the mirror on the cell. */
+#define HEATMAP_COUNT 3
+
+static const char* HEATMAP_NAMES[HEATMAP_COUNT] = {"occupancy", "beams", "mirror_hits"};
+
+/* Defines a log file mapped into memory, and the shape of its frames. */
+typedef struct
+{
+    const char* filename;
+    const char* data;
+    size_t size;
+    int height;
+    int width;
+    size_t frame_size;      /* Bytes of a frame: (height + 2) lines of width + 3. */
+    size_t separator_size;  /* Bytes of the separator between two frames. */
+} log_file_t;
+
+/* Defines the work and results of one thread. Each thread fills its own
+histograms; they are merged once all threads are joined. */
+typedef struct
+{
+    pthread_t thread;
+    bool started;           /* False if the range was processed without a thread. */
+    const log_file_t* log;
+    size_t begin;           /* Offset of the first frame to process. */
+    size_t end;             /* Frames starting at or after end are left out. */
+    unsigned long long* heatmaps[HEATMAP_COUNT];
+    long frames;
+    bool malformed;
+} worker_t;
+
+/* Prints the usage of the program. */
+static void usage(const char* program)
+{
+    fprintf(stderr, "Usage: %s [--threads <n>] [--format csv|binary] [--output <prefix>] %s\n",
+    program, "<log-filename>...");
+}
+
+/* Reads a whole argument as a number of at least 1 into value. Returns
+false, leaving value as it was, if the argument is anything else. */
+static bool parse_positive(const char* text, int* value)
+{
+    char* end;
+    long number;
+
+    number = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || number < 1 || number > INT_MAX)
+    {
+        return false;
+    }
+    *value = (int) number;
+    return true;
+}
+
+/* Returns true if the n bytes at p are all c. */
+static bool all_of(const char* p, size_t n, char c)
+{
+    size_t i;
+    for (i = 0; i < n; i++)
+    {
+        if (p[i] != c)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Works out the shape of the frames of a mapped log from its first frame.
+Returns false if the log doesn't start with a frame. */
+static bool read_shape(log_file_t* log)
+{
+    const char* newline;
+    size_t line;
+
+    newline = memchr(log->data, '\n', log->size);
+    if (!newline || newline - log->data < 2 || !all_of(log->data, newline - log->data, '*'))
+    {
+        return false;
+    }
+    line = (size_t) (newline - log->data) + 1;
+    log->width = (int) line - 3;
+
+    /* Count rows until the bottom border. */
+    log->height = 0;
+    while ((log->height + 2) * line <= log->size)
+    {
+        const char* row;
+        row = log->data + (log->height + 1) * line;
+        if (all_of(row, line - 1, '*'))
+        {
+            break;
+        }
+        log->height++;
+    }
+    log->frame_size = (log->height + 2) * line;
+    log->separator_size = line + 2;
+    return log->frame_size <= log->size;
+}
+
+/* Returns true if a whole, well-formed frame starts at offset. */
+static bool is_frame(const log_file_t* log, size_t offset)
+{
+    const char* frame;
+    size_t line;
+    int i;
+
+    if (offset + log->frame_size > log->size)
+    {
+        return false;
+    }
+    frame = log->data + offset;
+    line = (size_t) log->width + 3;
+    if (!all_of(frame, line - 1, '*') || !all_of(frame + log->frame_size - line, line - 1, '*'))
+    {
+        return false;
+    }
+    for (i = 1; i <= log->height; i++)
+    {
+        const char* row;
+        row = frame + i * line;
+        if (row[0] != '*' || row[line - 2] != '*' || row[line - 1] != '\n')
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Returns the offset of the frame following the frame at offset, or
+log->size if there is none. */
+static size_t next_frame(const log_file_t* log, size_t offset)
+{
+    size_t next;
+    next = offset + log->frame_size + log->separator_size;
+    return next < log->size ? next : log->size;
+}
+
+/* Returns the offset of the first frame at or after offset: frames start
+at the beginning of the log and two lines after every dash line. */
+static size_t align_to_frame(const log_file_t* log, size_t offset)
+{
+    const char* p;
+    const char* end;
+
+    if (offset == 0)
+    {
+        return 0;
+    }
+
+    /* Look for "\n-" and skip the dash line and the empty line after it. */
+    end = log->data + log->size;
+    for (p = log->data + offset - 1; p + 1 < end; p++)
+    {
+        p = memchr(p, '\n', end - p);
+        if (!p || p + 1 >= end)
+        {
+            break;
+        }
+        if (p[1] == '-')
+        {
+            const char* line_end;
+            line_end = memchr(p + 1, '\n', end - p - 1);
+            if (!line_end || line_end + 2 > end)
+            {
+                break;
+            }
+            return (size_t) (line_end + 2 - log->data);
+        }
+    }
+    return log->size;
+}
+
+/* Returns the cell of the frame at offset. */
+static char frame_cell(const log_file_t* log, size_t offset, int x, int y)
+{
+    return log->data[offset + (size_t) (x + 1) * (log->width + 3) + 1 + y];
+}
+
+/* Finds the laser beam in a frame. Returns false if there is none. */
+static bool find_beam(const log_file_t* log, size_t offset, pos_t* beam)
+{
+    int i, j;
+    for (i = 0; i < log->height; i++)
+    {
+        for (j = 0; j < log->width; j++)
+        {
+            char c;
+            c = frame_cell(log, offset, i, j);
+            if (c == '|' || c == '-')
+            {
+                beam->x = i;
+                beam->y = j;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/* Counts the mirrors a laser turned on between the beam of one frame and
+the beam of the next one: only mirrors can lie in between, so follow the
+laser from the first beam across mirrors and see if it lands on the second. */
+static void count_mirror_hits(const log_file_t* log, size_t offset, pos_t from, pos_t to,
+unsigned long long* hits)
+{
+    char dirs[2];
+    int d;
+
+    if (frame_cell(log, offset, from.x, from.y) == '|')
+    {
+        dirs[0] = 'u';
+        dirs[1] = 'd';
+    }
+    else
+    {
+        dirs[0] = 'l';
+        dirs[1] = 'r';
+    }
+
+    for (d = 0; d < 2; d++)
+    {
+        pos_t laser_pos;
+        char laser_dir;
+        int turns;
+
+        laser_pos = from;
+        laser_dir = dirs[d];
+        for (turns = 0; turns <= 4 * log->height * log->width; turns++)
+        {
+            char c;
+            advance_laser(&laser_pos, laser_dir);
+            if (laser_pos.x < 0 || laser_pos.x >= log->height
+            || laser_pos.y < 0 || laser_pos.y >= log->width)
+            {
+                break;
+            }
+            c = frame_cell(log, offset, laser_pos.x, laser_pos.y);
+            if (!is_mirror(c))
+            {
+                break;
+            }
+            laser_dir = reflect_laser(laser_dir, c);
+        }
+        if (laser_pos.x != to.x || laser_pos.y != to.y || turns == 0)
+        {
+            continue;
+        }
+
+        /* Found the way; count the mirrors along it. */
+        laser_pos = from;
+        laser_dir = dirs[d];
+        while (true)
+        {
+            char c;
+            advance_laser(&laser_pos, laser_dir);
+            if (laser_pos.x == to.x && laser_pos.y == to.y)
+            {
+                return;
+            }
+            c = frame_cell(log, offset, laser_pos.x, laser_pos.y);
+            hits[(size_t) laser_pos.x * log->width + laser_pos.y]++;
+            laser_dir = reflect_laser(laser_dir, c);
+        }
+    }
+}
+
+/* Collects the frames of one worker's range of a log. */
+static void* run_worker(void* arg)
+{
+    worker_t* worker;
+    const log_file_t* log;
+    size_t offset;
+
+    worker = arg;
+    log = worker->log;
+    for (offset = worker->begin; offset < worker->end; offset = next_frame(log, offset))
+    {
+        pos_t beam, next_beam;
+        size_t next;
+        int i, j;
+
+        if (!is_frame(log, offset))
+        {
+            worker->malformed = true;
+            break;
+        }
+        worker->frames++;
+
+        for (i = 0; i < log->height; i++)
+        {
+            for (j = 0; j < log->width; j++)
+            {
+                char c;
+                size_t cell;
+                c = frame_cell(log, offset, i, j);
+                cell = (size_t) i * log->width + j;
+                if (is_player(c))
+                {
+                    worker->heatmaps[HEATMAP_OCCUPANCY][cell]++;
+                }
+                else if (c == '|' || c == '-')
+                {
+                    worker->heatmaps[HEATMAP_BEAMS][cell]++;
+                }
+            }
+        }
+
+        /* Look at the next frame, even past the end of the range, to see
+        which mirrors the laser turned on in between. */
+        next = next_frame(log, offset);
+        if (find_beam(log, offset, &beam) && is_frame(log, next)
+        && find_beam(log, next, &next_beam))
+        {
+            count_mirror_hits(log, offset, beam, next_beam,
+            worker->heatmaps[HEATMAP_MIRROR_HITS]);
+        }
+    }
+    return NULL;
+}
+
+/* Writes a heatmap as CSV, one line per row of the map. */
+static bool write_csv(const char* filename, const unsigned long long* heatmap,
+int height, int width)
+{
+    FILE* outfile;
+    int i, j;
+
+    outfile = fopen(filename, "w");
+    if (! outfile)
+    {
+        fprintf(stderr, "Couldn't open %s for writing.\n", filename);
+        return false;
+    }
+    for (i = 0; i < height; i++)
+    {
+        for (j = 0; j < width; j++)
+        {
+            fprintf(outfile, j ? ",%llu" : "%llu", heatmap[(size_t) i * width + j]);
+        }
+        fprintf(outfile, "\n");
+    }
+    fclose(outfile);
+    return true;
+}
+
+/* Writes a heatmap as "LTHM", the height and width as 32-bit integers and
+the counts as 64-bit integers, row by row, all in host byte order. */
+static bool write_binary(const char* filename, const unsigned long long* heatmap,
+int height, int width)
+{
+    FILE* outfile;
+    unsigned int dims[2];
+
+    outfile = fopen(filename, "wb");
+    if (! outfile)
+    {
+        fprintf(stderr, "Couldn't open %s for writing.\n", filename);
+        return false;
+    }
+    dims[0] = (unsigned int) height;
+    dims[1] = (unsigned int) width;
+    fwrite("LTHM", 1, 4, outfile);
+    fwrite(dims, sizeof(dims[0]), 2, outfile);
+    fwrite(heatmap, sizeof(heatmap[0]), (size_t) height * width, outfile);
+    fclose(outfile);
+    return true;
+}
+
+/* Maps a log file into memory. */
+static bool map_log(log_file_t* log, const char* filename)
+{
+    struct stat info;
+    int fd;
+
+    log->filename = filename;
+    fd = open(filename, O_RDONLY);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Couldn't open %s for reading.\n", filename);
+        return false;
+    }
+    if (fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        fprintf(stderr, "%s is empty.\n", filename);
+        close(fd);
+        return false;
+    }
+    log->size = (size_t) info.st_size;
+    log->data = mmap(NULL, log->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (log->data == MAP_FAILED)
+    {
+        fprintf(stderr, "Couldn't map %s.\n", filename);
+        return false;
+    }
+    return true;
+}
+
+/* Aggregates game logs into heatmaps and statistics. */
+int main(int argc, char** argv)
+{
+    const char* format = "csv";
+    const char* prefix = "";
+    int threads;
+    int height, width;
+    unsigned long long* totals[HEATMAP_COUNT];
+    worker_t* workers;
+    long total_frames, games;
+    size_t total_bytes;
+    long long start, elapsed;
+    int first_log;
+    int i, k, t;
+
+    threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+
+    /* Parse options. */
+    for (i = 1; i < argc && strncmp(argv[i], "--", 2) == 0; i += 2)
+    {
+        if (i + 1 >= argc)
+        {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        if (strcmp(argv[i], "--threads") == 0)
+        {
+            if (!parse_positive(argv[i + 1], &threads))
+            {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        }
+        else if (strcmp(argv[i], "--format") == 0)
+        {
+            format = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "--output") == 0)
+        {
+            prefix = argv[i + 1];
+        }
+        else
+        {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    first_log = i;
+    if (first_log >= argc || (strcmp(format, "csv") != 0 && strcmp(format, "binary") != 0))
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (threads <= 0)
+    {
+        threads = 1;
+    }
+
+    workers = calloc(threads, sizeof(worker_t));
+    height = width = -1;
+    for (k = 0; k < HEATMAP_COUNT; k++)
+    {
+        totals[k] = NULL;
+    }
+    total_frames = 0;
+    total_bytes = 0;
+    games = 0;
+    start = usec_now();
+
+    printf("log,frames\n");
+    for (i = first_log; i < argc; i++)
+    {
+        log_file_t log;
+        size_t cells;
+        long frames;
+        bool malformed;
+
+        if (!map_log(&log, argv[i]))
+        {
+            continue;
+        }
+        if (!read_shape(&log))
+        {
+            fprintf(stderr, "%s is not a game log.\n", argv[i]);
+            munmap((void*) log.data, log.size);
+            continue;
+        }
+
+        /* Heatmaps add up cell by cell, so every log must have one shape. */
+        if (height < 0)
+        {
+            height = log.height;
+            width = log.width;
+            for (k = 0; k < HEATMAP_COUNT; k++)
+            {
+                totals[k] = calloc((size_t) height * width, sizeof(unsigned long long));
+            }
+        }
+        else if (log.height != height || log.width != width)
+        {
+            fprintf(stderr, "%s is not a %dx%d map like the logs before it; skipped.\n",
+            argv[i], height, width);
+            munmap((void*) log.data, log.size);
+            continue;
+        }
+        cells = (size_t) height * width;
+
+        /* Split the log into byte ranges aligned on frame boundaries. */
+        for (t = 0; t < threads; t++)
+        {
+            workers[t].log = &log;
+            workers[t].begin = align_to_frame(&log, log.size * t / threads);
+            workers[t].end = align_to_frame(&log, log.size * (t + 1) / threads);
+            workers[t].frames = 0;
+            workers[t].malformed = false;
+            for (k = 0; k < HEATMAP_COUNT; k++)
+            {
+                workers[t].heatmaps[k] = calloc(cells, sizeof(unsigned long long));
+            }
+            workers[t].started = pthread_create(&workers[t].thread, NULL, run_worker,
+            &workers[t]) == 0;
+            if (!workers[t].started)
+            {
+                fprintf(stderr, "Couldn't start thread %d; processing its frames here.\n", t);
+                run_worker(&workers[t]);
+            }
+        }
+
+        /* Merge. */
+        frames = 0;
+        malformed = false;
+        for (t = 0; t < threads; t++)
+        {
+            size_t c;
+            if (workers[t].started)
+            {
+                pthread_join(workers[t].thread, NULL);
+            }
+            frames += workers[t].frames;
+            malformed = malformed || workers[t].malformed;
+            for (k = 0; k < HEATMAP_COUNT; k++)
+            {
+                for (c = 0; c < cells; c++)
+                {
+                    totals[k][c] += workers[t].heatmaps[k][c];
+                }
+                free(workers[t].heatmaps[k]);
+            }
+        }
+        if (malformed)
+        {
+            fprintf(stderr, "%s has malformed frames; counted up to them.\n", argv[i]);
+        }
+        printf("%s,%ld\n", argv[i], frames);
+        total_frames += frames;
+        total_bytes += log.size;
+        games++;
+        munmap((void*) log.data, log.size);
+    }
+    elapsed = usec_now() - start;
+
+    /* Write heatmaps. */
+    if (games > 0)
+    {
+        for (k = 0; k < HEATMAP_COUNT; k++)
+        {
+            char filename[4096];
+            snprintf(filename, sizeof(filename), "%s%s.%s", prefix, HEATMAP_NAMES[k],
+            strcmp(format, "csv") == 0 ? "csv" : "bin");
+            if (strcmp(format, "csv") == 0)
+            {
+                write_csv(filename, totals[k], height, width);
+            }
+            else
+            {
+                write_binary(filename, totals[k], height, width);
+            }
+        }
+    }
+
+    /* Report. */
+    fprintf(stderr, "%ld game(s), %ld frames (%.1f per game), %.1f MB in %.3f s "
+    "(%.1f MB/s) on %d thread(s)\n", games, total_frames,
+    games ? (double) total_frames / games : 0.0, total_bytes / 1e6, elapsed / 1e6,
+    total_bytes / 1e6 / (elapsed > 0 ? elapsed / 1e6 : 1e-6), threads);
+
+    for (k = 0; k < HEATMAP_COUNT; k++)
+    {
+        free(totals[k]);
+    }
+    free(workers);
+    return games > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,156 @@
+#include "beam.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Bits per word of the visited bitset. */
+#define WORD_BITS (sizeof(unsigned long) * CHAR_BIT)
+
+long beam_step_budget = 0;
+
+/* Returns the index of a direction in the visited bitset. */
+static int dir_index(char dir)
+{
+    switch (dir)
+    {
+        case 'u': return 0;
+        case 'd': return 1;
+        case 'l': return 2;
+        default: return 3;
+    }
+}
+
+/* Sizes the visited bitset for a map, keeping it if the size is unchanged. */
+static void prepare(beam_tracer_t* tracer, int height, int width)
+{
+    size_t words;
+
+    if (tracer->visited && tracer->height == height && tracer->width == width)
+    {
+        return;
+    }
+    words = ((size_t) height * width * 4 + WORD_BITS - 1) / WORD_BITS;
+    free(tracer->visited);
+    free(tracer->touched);
+    tracer->visited = calloc(words > 0 ? words : 1, sizeof(unsigned long));
+    tracer->touched = malloc(sizeof(size_t) * (words > 0 ? words : 1));
+    tracer->touched_count = 0;
+    tracer->height = height;
+    tracer->width = width;
+}
+
+/* Marks a state visited. Returns false if it already was. */
+static bool visit(beam_tracer_t* tracer, pos_t pos, char dir)
+{
+    size_t bit, word;
+    unsigned long mask;
+
+    bit = ((size_t) pos.x * tracer->width + pos.y) * 4 + dir_index(dir);
+    word = bit / WORD_BITS;
+    mask = 1UL << (bit % WORD_BITS);
+    if (tracer->visited[word] & mask)
+    {
+        return false;
+    }
+    if (!tracer->visited[word])
+    {
+        tracer->touched[tracer->touched_count++] = word;
+    }
+    tracer->visited[word] |= mask;
+    return true;
+}
+
+/* Appends a cell to the trail. */
+static void extend_trail(beam_tracer_t* tracer, pos_t pos, char laser)
+{
+    if ((size_t) tracer->steps == tracer->trail_capacity)
+    {
+        tracer->trail_capacity = tracer->trail_capacity ? tracer->trail_capacity * 2 : 64;
+        tracer->trail = realloc(tracer->trail, sizeof(beam_cell_t) * tracer->trail_capacity);
+    }
+    tracer->trail[tracer->steps].pos = pos;
+    tracer->trail[tracer->steps].laser = laser;
+    tracer->steps++;
+}
+
+beam_end_t trace_beam(beam_tracer_t* tracer, char** grid, int height, int width,
+pos_t shooter, char dir, pos_t target)
+{
+    /* Laser vector. */
+    pos_t laser_pos;
+    char laser_dir;
+
+    long taken;
+    beam_end_t end;
+    size_t k;
+
+    prepare(tracer, height, width);
+    tracer->steps = 0;
+    laser_pos = shooter;
+    laser_dir = dir;
+
+    for (taken = 0; ; taken++)
+    {
+        /* Advance. */
+        if (beam_step_budget > 0 && taken == beam_step_budget)
+        {
+            end = BEAM_BUDGET;
+            break;
+        }
+        advance_laser(&laser_pos, laser_dir);
+
+        /* If laser is out of bounds, stop. */
+        if (laser_pos.x < 0 || laser_pos.x >= height
+        || laser_pos.y < 0 || laser_pos.y >= width)
+        {
+            end = BEAM_EXIT;
+            break;
+        }
+
+        /* If laser hits either tank, stop. */
+        if (laser_pos.x == target.x && laser_pos.y == target.y)
+        {
+            end = BEAM_TARGET;
+            break;
+        }
+        if (laser_pos.x == shooter.x && laser_pos.y == shooter.y)
+        {
+            end = BEAM_SELF;
+            break;
+        }
+
+        /* If laser was here before going the same way, it is circling. */
+        if (!visit(tracer, laser_pos, laser_dir))
+        {
+            end = BEAM_CYCLE;
+            break;
+        }
+
+        /* If laser hits the mirror, change direction; else it is drawn. */
+        if (is_mirror(grid[laser_pos.x][laser_pos.y]))
+        {
+            laser_dir = reflect_laser(laser_dir, grid[laser_pos.x][laser_pos.y]);
+        }
+        else
+        {
+            extend_trail(tracer, laser_pos, get_laser(laser_dir));
+        }
+    }
+    tracer->end = laser_pos;
+
+    /* Leave the bitset clear for the next shot. */
+    for (k = 0; k < tracer->touched_count; k++)
+    {
+        tracer->visited[tracer->touched[k]] = 0;
+    }
+    tracer->touched_count = 0;
+    return end;
+}
+
+void free_beam_tracer(beam_tracer_t* tracer)
+{
+    free(tracer->visited);
+    free(tracer->touched);
+    free(tracer->trail);
+    memset(tracer, 0, sizeof(*tracer));
+}
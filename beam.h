@@ -0,0 +1,68 @@
+#ifndef BEAM_H
+#define BEAM_H
+#include <stddef.h>
+#include "utils.h"
+
+/* Laser tracing with bounded work.
+ *
+ * A laser stops when it leaves the map, reaches the target tank or comes
+ * back to the tank which fired it. Mirrors alone cannot make it circle
+ * forever, since a laser which retraces its way comes back to the shooter
+ * first, but tracing does not rely on that: every (cell, direction) state
+ * is marked in a visited bitset and a repeated state ends the trace, and so
+ * does reaching beam_step_budget. The bitset is kept by the tracer between
+ * shots and only the words a shot touched are cleared after it. */
+
+/** Defines the ways a traced laser can end. */
+typedef enum
+{
+    BEAM_EXIT,      /* The laser left the map. */
+    BEAM_TARGET,    /* The laser reached the target tank. */
+    BEAM_SELF,      /* The laser came back to the shooter, which stopped it. */
+    BEAM_CYCLE,     /* The laser came back to a state it had been in. */
+    BEAM_BUDGET     /* The laser took beam_step_budget steps. */
+} beam_end_t;
+
+/** Defines a cell a laser is drawn on, in the order the laser reaches it. */
+typedef struct
+{
+    pos_t pos;
+    char laser;     /* Laser character drawn on the cell. */
+    char under;     /* Character under the laser while it is drawn. */
+} beam_cell_t;
+
+/** Defines a reusable laser tracer. A zeroed tracer is empty and valid. */
+typedef struct
+{
+    int height;                 /* Size of the map the bitset is for. */
+    int width;
+    unsigned long* visited;     /* 4 bits per cell, one per direction. */
+    size_t* touched;            /* Words of visited with bits set. */
+    size_t touched_count;
+    beam_cell_t* trail;         /* Free cells crossed by the last laser. */
+    size_t trail_capacity;
+    int steps;                  /* Number of cells in trail. */
+    pos_t end;                  /* Where the last laser ended. */
+} beam_tracer_t;
+
+/** Most steps, mirrors included, a laser takes per shot before it is cut
+ * short; 0 for no limit other than the number of states of the map. */
+extern long beam_step_budget;
+
+/** Traces the laser of a tank, without drawing it.
+ * @param tracer tracer, reallocated when the map size changes.
+ * @param grid pointer to the 2D array of characters representing the map.
+ * @param height number of rows in the grid.
+ * @param width number of columns in the grid.
+ * @param shooter position of the firing tank.
+ * @param dir direction the laser leaves the shooter in.
+ * @param target position of the other tank.
+ * @return how the laser ended; tracer->trail, steps and end describe it. */
+beam_end_t trace_beam(beam_tracer_t* tracer, char** grid, int height, int width,
+pos_t shooter, char dir, pos_t target);
+
+/** Frees heap memory associated with a tracer, leaving it empty.
+ * @param tracer tracer to free. */
+void free_beam_tracer(beam_tracer_t* tracer);
+
+#endif  /* BEAM_H */
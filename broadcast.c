@@ -0,0 +1,479 @@
+#define _POSIX_C_SOURCE 200809L
+#include "broadcast.h"
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* "LTBC" read as a little-endian word, and the version of the layout. */
+#define BROADCAST_MAGIC 0x4342544CU
+#define BROADCAST_VERSION 2U
+
+/* Kinds of slots. */
+#define SLOT_RESYNC 0U      /* Too many cells changed; copy the newest frame. */
+#define SLOT_DIFF 1U
+
+/* Times a watcher tries to copy the newest frame in one poll. */
+#define COPY_ATTEMPTS 4
+
+/* Bytes per changed cell in a diff: its index and its new character. */
+#define DIFF_ENTRY 5
+
+broadcast_t* frame_broadcast = NULL;
+
+/** Defines the header at the start of the shared memory. */
+typedef struct
+{
+    uint32_t magic;         /* Stored last, once the rest is valid. */
+    uint32_t version;
+    int32_t height;
+    int32_t width;
+    uint32_t slot_count;
+    uint32_t ended;
+    uint64_t seq;           /* Sequence lock of the newest frame. */
+    uint64_t head;          /* Number of the newest frame, 0 before the first. */
+    int32_t focus_x, focus_y;
+    int32_t player_x, player_y;
+    int32_t enemy_x, enemy_y;
+} shm_header_t;             /* Followed by the cells of the newest frame. */
+
+/** Defines the header of a slot, followed by its payload. */
+typedef struct
+{
+    uint64_t seq;           /* Sequence lock of the slot. */
+    uint64_t number;        /* Number of the frame in the slot. */
+    uint32_t kind;
+    uint32_t length;        /* Bytes of payload. */
+    int32_t focus_x, focus_y;
+    int32_t player_x, player_y;
+    int32_t enemy_x, enemy_y;
+} shm_slot_t;
+
+/* Returns the bytes between the starts of two slots. */
+static size_t slot_stride(int height, int width)
+{
+    return sizeof(shm_slot_t) + (((size_t) height * width + 7) & ~(size_t) 7);
+}
+
+/* Returns the bytes of the newest frame, padded like a slot's payload. */
+static size_t frame_stride(int height, int width)
+{
+    return ((size_t) height * width + 7) & ~(size_t) 7;
+}
+
+/* Returns the bytes of shared memory for a map of a given size. */
+static size_t shm_size(int height, int width)
+{
+    return sizeof(shm_header_t) + frame_stride(height, width)
+    + BROADCAST_SLOTS * slot_stride(height, width);
+}
+
+/* Returns the cells of the newest frame. */
+static unsigned char* shared_frame(const broadcast_t* broadcast)
+{
+    return broadcast->shm + sizeof(shm_header_t);
+}
+
+/* Returns the slot holding a frame. */
+static shm_slot_t* slot_of(const broadcast_t* broadcast, unsigned long long number)
+{
+    return (shm_slot_t*) (broadcast->shm + sizeof(shm_header_t)
+    + frame_stride(broadcast->height, broadcast->width)
+    + (number % BROADCAST_SLOTS) * slot_stride(broadcast->height, broadcast->width));
+}
+
+/* Copies a name, adding the leading / shm_open wants. */
+static void set_name(broadcast_t* broadcast, const char* name)
+{
+    snprintf(broadcast->name, sizeof(broadcast->name), "%s%s",
+    name[0] == '/' ? "" : "/", name);
+}
+
+/* Allocates the frame of a broadcast and points its rows into it. */
+static void allocate_frame(broadcast_t* broadcast)
+{
+    int i;
+    broadcast->frame = calloc((size_t) broadcast->height * broadcast->width + 1, 1);
+    broadcast->rows = malloc(sizeof(char*) * (broadcast->height + 1));
+    for (i = 0; i < broadcast->height; i++)
+    {
+        broadcast->rows[i] = broadcast->frame + (size_t) i * broadcast->width;
+    }
+    broadcast->scratch = NULL;
+    broadcast->changed = NULL;
+    broadcast->changes = NULL;
+    broadcast->change_count = 0;
+    broadcast->number = 0;
+}
+
+bool open_broadcast(broadcast_t* broadcast, const char* name, int height, int width)
+{
+    shm_header_t* header;
+    int fd;
+
+    set_name(broadcast, name);
+    broadcast->height = height;
+    broadcast->width = width;
+    broadcast->size = shm_size(height, width);
+
+    /* Start from a fresh object, so watchers of a stale one are not
+    confused by it. */
+    shm_unlink(broadcast->name);
+    fd = shm_open(broadcast->name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Couldn't create broadcast %s.\n", broadcast->name);
+        return false;
+    }
+    if (ftruncate(fd, (off_t) broadcast->size) != 0)
+    {
+        fprintf(stderr, "Couldn't size broadcast %s.\n", broadcast->name);
+        close(fd);
+        shm_unlink(broadcast->name);
+        return false;
+    }
+    broadcast->shm = mmap(NULL, broadcast->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (broadcast->shm == MAP_FAILED)
+    {
+        fprintf(stderr, "Couldn't map broadcast %s.\n", broadcast->name);
+        shm_unlink(broadcast->name);
+        return false;
+    }
+
+    /* ftruncate zeroed the slots; fill the header, magic last. */
+    header = (shm_header_t*) broadcast->shm;
+    header->version = BROADCAST_VERSION;
+    header->height = height;
+    header->width = width;
+    header->slot_count = BROADCAST_SLOTS;
+    __atomic_store_n(&header->magic, BROADCAST_MAGIC, __ATOMIC_RELEASE);
+
+    allocate_frame(broadcast);
+    broadcast->changed = calloc((size_t) height * width + 1, 1);
+    broadcast->changes = malloc(sizeof(size_t) * ((size_t) height * width + 1));
+    return true;
+}
+
+void note_changed_cell(broadcast_t* broadcast, int x, int y)
+{
+    size_t index;
+
+    if (x < 0 || x >= broadcast->height || y < 0 || y >= broadcast->width)
+    {
+        return;
+    }
+    index = (size_t) x * broadcast->width + y;
+    if (!broadcast->changed[index])
+    {
+        broadcast->changed[index] = 1;
+        broadcast->changes[broadcast->change_count++] = index;
+    }
+}
+
+void publish_frame(broadcast_t* broadcast, char** grid, pos_t focus, pos_t player,
+pos_t enemy)
+{
+    shm_header_t* header;
+    shm_slot_t* slot;
+    unsigned char* payload;
+    unsigned char* newest;
+    unsigned long long number;
+    uint64_t seq;
+    size_t cells, length, max_length;
+    size_t k;
+    bool resync;
+    int i;
+
+    header = (shm_header_t*) broadcast->shm;
+    newest = shared_frame(broadcast);
+    number = broadcast->number + 1;
+    slot = slot_of(broadcast, number);
+    payload = (unsigned char*) (slot + 1);
+    cells = (size_t) broadcast->height * broadcast->width;
+
+    /* Make the slot odd: readers of the frame it held give up on it. */
+    seq = slot->seq;
+    __atomic_store_n(&slot->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    /* Write the noted cells which did change, unless there are more than
+    the slot holds; the first frame is copied whole. */
+    resync = broadcast->number == 0;
+    if (resync)
+    {
+        for (i = 0; i < broadcast->height; i++)
+        {
+            memcpy(broadcast->rows[i], grid[i], broadcast->width);
+        }
+    }
+    length = 0;
+    max_length = cells - cells % DIFF_ENTRY;
+    for (k = 0; k < broadcast->change_count; k++)
+    {
+        size_t index;
+        char c;
+
+        index = broadcast->changes[k];
+        c = grid[index / broadcast->width][index % broadcast->width];
+        if (broadcast->frame[index] == c)
+        {
+            continue;
+        }
+        broadcast->frame[index] = c;
+        if (!resync && length == max_length)
+        {
+            resync = true;
+        }
+        if (!resync)
+        {
+            uint32_t cell;
+            cell = (uint32_t) index;
+            memcpy(payload + length, &cell, sizeof(cell));
+            payload[length + 4] = (unsigned char) c;
+            length += DIFF_ENTRY;
+        }
+    }
+    slot->number = number;
+    slot->kind = resync ? SLOT_RESYNC : SLOT_DIFF;
+    slot->length = resync ? 0U : (uint32_t) length;
+    slot->focus_x = focus.x;
+    slot->focus_y = focus.y;
+    slot->player_x = player.x;
+    slot->player_y = player.y;
+    slot->enemy_x = enemy.x;
+    slot->enemy_y = enemy.y;
+    __atomic_store_n(&slot->seq, seq + 2, __ATOMIC_RELEASE);
+
+    /* Bring the newest frame up to date, and announce it. */
+    seq = header->seq;
+    __atomic_store_n(&header->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    if (broadcast->number == 0)
+    {
+        memcpy(newest, broadcast->frame, cells);
+    }
+    for (k = 0; k < broadcast->change_count; k++)
+    {
+        size_t index;
+        index = broadcast->changes[k];
+        newest[index] = (unsigned char) broadcast->frame[index];
+        broadcast->changed[index] = 0;
+    }
+    broadcast->change_count = 0;
+    header->focus_x = focus.x;
+    header->focus_y = focus.y;
+    header->player_x = player.x;
+    header->player_y = player.y;
+    header->enemy_x = enemy.x;
+    header->enemy_y = enemy.y;
+    __atomic_store_n(&header->head, number, __ATOMIC_RELAXED);
+    __atomic_store_n(&header->seq, seq + 2, __ATOMIC_RELEASE);
+    broadcast->number = number;
+}
+
+void close_broadcast(broadcast_t* broadcast)
+{
+    shm_header_t* header;
+    header = (shm_header_t*) broadcast->shm;
+    __atomic_store_n(&header->ended, 1U, __ATOMIC_RELEASE);
+    munmap(broadcast->shm, broadcast->size);
+    shm_unlink(broadcast->name);
+    free(broadcast->frame);
+    free(broadcast->rows);
+    free(broadcast->changed);
+    free(broadcast->changes);
+}
+
+bool attach_broadcast(broadcast_t* broadcast, const char* name)
+{
+    const shm_header_t* header;
+    struct stat info;
+    int fd;
+
+    set_name(broadcast, name);
+    fd = shm_open(broadcast->name, O_RDONLY, 0);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Couldn't open broadcast %s.\n", broadcast->name);
+        return false;
+    }
+    if (fstat(fd, &info) != 0 || (size_t) info.st_size < sizeof(shm_header_t))
+    {
+        fprintf(stderr, "Broadcast %s is not ready.\n", broadcast->name);
+        close(fd);
+        return false;
+    }
+    broadcast->size = (size_t) info.st_size;
+    broadcast->shm = mmap(NULL, broadcast->size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (broadcast->shm == MAP_FAILED)
+    {
+        fprintf(stderr, "Couldn't map broadcast %s.\n", broadcast->name);
+        return false;
+    }
+
+    /* Check the header before trusting the size it gives. */
+    header = (const shm_header_t*) broadcast->shm;
+    if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != BROADCAST_MAGIC
+    || header->version != BROADCAST_VERSION || header->height <= 0 || header->width <= 0
+    || header->slot_count != BROADCAST_SLOTS
+    || shm_size(header->height, header->width) != broadcast->size)
+    {
+        fprintf(stderr, "%s is not a broadcast of this version.\n", broadcast->name);
+        munmap(broadcast->shm, broadcast->size);
+        return false;
+    }
+    broadcast->height = header->height;
+    broadcast->width = header->width;
+
+    allocate_frame(broadcast);
+    broadcast->scratch = malloc((size_t) broadcast->height * broadcast->width + 1);
+    return true;
+}
+
+/* Copies the changes of a frame out of its slot and applies them. Returns
+false if the slot was overwritten meanwhile, the frame does not follow the
+one held or its changes are not in the slot. */
+static bool read_slot(broadcast_t* broadcast, unsigned long long number)
+{
+    const shm_slot_t* slot;
+    shm_slot_t copy;
+    uint64_t seq;
+    size_t k;
+
+    slot = slot_of(broadcast, number);
+    seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    if (seq & 1U)
+    {
+        return false;
+    }
+    memcpy(&copy, slot, sizeof(copy));
+    if (copy.length > (size_t) broadcast->height * broadcast->width)
+    {
+        return false;
+    }
+    memcpy(broadcast->scratch, slot + 1, copy.length);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq || copy.number != number
+    || copy.kind != SLOT_DIFF || broadcast->number + 1 != number)
+    {
+        return false;
+    }
+
+    /* The copy is consistent; apply it. */
+    for (k = 0; k + DIFF_ENTRY <= copy.length; k += DIFF_ENTRY)
+    {
+        uint32_t index;
+        memcpy(&index, broadcast->scratch + k, sizeof(index));
+        if (index < (size_t) broadcast->height * broadcast->width)
+        {
+            broadcast->frame[index] = (char) broadcast->scratch[k + 4];
+        }
+    }
+    broadcast->number = number;
+    broadcast->focus.x = copy.focus_x;
+    broadcast->focus.y = copy.focus_y;
+    broadcast->player.x = copy.player_x;
+    broadcast->player.y = copy.player_y;
+    broadcast->enemy.x = copy.enemy_x;
+    broadcast->enemy.y = copy.enemy_y;
+    return true;
+}
+
+/* Copies the newest frame. Returns false if it kept changing under the
+copy, leaving the frame of the watcher as it was. */
+static bool copy_newest(broadcast_t* broadcast)
+{
+    const shm_header_t* header;
+    shm_header_t copy;
+    uint64_t seq;
+    int attempt;
+
+    header = (const shm_header_t*) broadcast->shm;
+    for (attempt = 0; attempt < COPY_ATTEMPTS; attempt++)
+    {
+        seq = __atomic_load_n(&header->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1U)
+        {
+            continue;
+        }
+        memcpy(&copy, header, sizeof(copy));
+        memcpy(broadcast->scratch, shared_frame(broadcast),
+        (size_t) broadcast->height * broadcast->width);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&header->seq, __ATOMIC_RELAXED) != seq)
+        {
+            continue;
+        }
+
+        /* The copy is consistent; take it. */
+        memcpy(broadcast->frame, broadcast->scratch,
+        (size_t) broadcast->height * broadcast->width);
+        broadcast->number = copy.head;
+        broadcast->focus.x = copy.focus_x;
+        broadcast->focus.y = copy.focus_y;
+        broadcast->player.x = copy.player_x;
+        broadcast->player.y = copy.player_y;
+        broadcast->enemy.x = copy.enemy_x;
+        broadcast->enemy.y = copy.enemy_y;
+        return true;
+    }
+    return false;
+}
+
+broadcast_status_t poll_broadcast(broadcast_t* broadcast)
+{
+    const shm_header_t* header;
+    uint64_t seq, head;
+    bool ended, updated;
+
+    /* Read the number of the newest frame consistently. The end is read
+    first: once it is seen, the newest frame read after it is the last. */
+    header = (const shm_header_t*) broadcast->shm;
+    ended = __atomic_load_n(&header->ended, __ATOMIC_ACQUIRE) != 0;
+    do
+    {
+        seq = __atomic_load_n(&header->seq, __ATOMIC_ACQUIRE);
+        head = __atomic_load_n(&header->head, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    }
+    while ((seq & 1U) || __atomic_load_n(&header->seq, __ATOMIC_RELAXED) != seq);
+
+    /* Follow the changes while they are all in the ring, and copy the
+    newest frame when they are not or one of them can't be read. */
+    updated = false;
+    if (broadcast->number > 0 && head - broadcast->number <= BROADCAST_SLOTS)
+    {
+        while (broadcast->number < head && read_slot(broadcast, broadcast->number + 1))
+        {
+            updated = true;
+        }
+    }
+    if (broadcast->number < head && copy_newest(broadcast))
+    {
+        updated = true;
+    }
+
+    if (updated)
+    {
+        return BROADCAST_FRAME;
+    }
+    if (broadcast->number >= head && ended)
+    {
+        return BROADCAST_ENDED;
+    }
+    return BROADCAST_IDLE;
+}
+
+void detach_broadcast(broadcast_t* broadcast)
+{
+    munmap(broadcast->shm, broadcast->size);
+    free(broadcast->frame);
+    free(broadcast->rows);
+    free(broadcast->scratch);
+}
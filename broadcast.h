@@ -0,0 +1,99 @@
+#ifndef BROADCAST_H
+#define BROADCAST_H
+#include <stdbool.h>
+#include <stddef.h>
+#include "utils.h"
+
+/* Frame broadcast to spectators through POSIX shared memory.
+ *
+ * The game publishes every frame it draws into a shared memory object
+ * holding the newest frame and a ring of slots with the cells each frame
+ * changed. The cells come from set_cell, which notes every change to the
+ * game grid, so publishing a frame costs the number of cells it changed
+ * rather than the size of the map. The newest frame, and each slot, is
+ * guarded by a sequence lock: the writer makes the sequence odd while it
+ * writes and readers retry or give up when the sequence changed under
+ * them. The producer therefore never waits for readers. A reader follows
+ * the changes slot by slot, and one which starts late, falls behind the
+ * ring or meets a frame too changed for a slot copies the newest frame. */
+
+/* Number of frame slots in the ring. */
+#define BROADCAST_SLOTS 16
+
+/** Defines the outcome of polling a broadcast. */
+typedef enum
+{
+    BROADCAST_IDLE,     /* No new frame. */
+    BROADCAST_FRAME,    /* The frame was brought up to date. */
+    BROADCAST_ENDED     /* The producer closed the broadcast. */
+} broadcast_status_t;
+
+/** Defines one end of a broadcast, either the producer or a watcher. */
+typedef struct
+{
+    char name[256];
+    int height;
+    int width;
+    size_t size;                    /* Bytes of shared memory mapped. */
+    unsigned char* shm;
+    char* frame;                    /* Newest frame published or received. */
+    char** rows;                    /* Rows of frame, for drawing it. */
+    unsigned char* scratch;         /* Watcher: payload copied out of a slot. */
+    unsigned char* changed;         /* Producer: per cell, true once noted. */
+    size_t* changes;                /* Producer: cells noted since the last frame. */
+    size_t change_count;
+    unsigned long long number;      /* Number of frame, 0 before the first. */
+    pos_t focus;                    /* Watcher: cell the producer focused on. */
+    pos_t player;                   /* Watcher: position of the player tank. */
+    pos_t enemy;                    /* Watcher: position of the enemy tank. */
+} broadcast_t;
+
+/** Broadcast the game publishes its frames to, and set_cell notes changed
+ * cells for, or NULL for none. */
+extern broadcast_t* frame_broadcast;
+
+/** Creates a broadcast, replacing a stale one of the same name.
+ * @param broadcast broadcast to create.
+ * @param name name of the shared memory object, with or without leading /.
+ * @param height number of rows in the map.
+ * @param width number of columns in the map.
+ * @return true on success, false with a message on stderr otherwise. */
+bool open_broadcast(broadcast_t* broadcast, const char* name, int height, int width);
+
+/** Notes that a cell of the published grid may have changed.
+ * @param broadcast broadcast created by open_broadcast.
+ * @param x row of the cell.
+ * @param y column of the cell. */
+void note_changed_cell(broadcast_t* broadcast, int x, int y);
+
+/** Publishes a frame: the grid as it was, plus the cells noted since.
+ * Never blocks. The first frame copies the whole grid.
+ * @param broadcast broadcast created by open_broadcast.
+ * @param grid pointer to the 2D array of characters representing the frame.
+ * @param focus cell the frame is drawn around.
+ * @param player position of the player tank.
+ * @param enemy position of the enemy tank. */
+void publish_frame(broadcast_t* broadcast, char** grid, pos_t focus, pos_t player,
+pos_t enemy);
+
+/** Tells watchers the broadcast ended, then removes it.
+ * @param broadcast broadcast created by open_broadcast. */
+void close_broadcast(broadcast_t* broadcast);
+
+/** Attaches to a broadcast read-only.
+ * @param broadcast broadcast to attach.
+ * @param name name of the shared memory object, with or without leading /.
+ * @return true on success, false with a message on stderr otherwise. */
+bool attach_broadcast(broadcast_t* broadcast, const char* name);
+
+/** Brings the frame of a watcher up to date, copying the newest frame if
+ * the watcher can't follow the changes to it.
+ * @param broadcast broadcast attached by attach_broadcast.
+ * @return whether the frame changed or the broadcast ended. */
+broadcast_status_t poll_broadcast(broadcast_t* broadcast);
+
+/** Detaches from a broadcast.
+ * @param broadcast broadcast attached by attach_broadcast. */
+void detach_broadcast(broadcast_t* broadcast);
+
+#endif  /* BROADCAST_H */
@@ -0,0 +1,885 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "beam.h"
+#include "editor.h"
+#include "eventlog.h"
+#include "game.h"
+#include "killmap.h"
+#include "mapcheck.h"
+#include "policy.h"
+#include "reference.h"
+#include "sleep.h"
+#include "state.h"
+#include "utils.h"
+#include "zobrist.h"
+
+/* Game state of the engine under test, which plays every case. */
+pos_t player_pos, enemy_pos;
+event_log_t game_log;
+
+/* Lasers are drawn without waiting; the drawing goes to /dev/null. */
+const unsigned SLEEP_DURATION = 0U;
+
+/* Largest height and width of a generated map. */
+#define MAX_SIDE 8
+
+/* Most objects on a map: two tanks, the rest mirrors. */
+#define MAX_OBJECTS (MAX_SIDE * MAX_SIDE)
+
+/* Longest generated move script. */
+#define MAX_SCRIPT 40
+
+/* Size of the text of a map. */
+#define MAP_TEXT_SIZE (16 + MAX_OBJECTS * 16)
+
+/* Size of the description of a mismatch. */
+#define MISMATCH_SIZE 256
+
+/* Defines a test case: a map and the moves of the player, one of w, s,
+a, d or f per turn. Objects 0 and 1 are the player and enemy tanks. */
+typedef struct
+{
+    int height;
+    int width;
+    int count;
+    int x[MAX_OBJECTS];
+    int y[MAX_OBJECTS];
+    char dir[MAX_OBJECTS];  /* u/d/l/r for tanks, f/b for mirrors. */
+    char script[MAX_SCRIPT + 1];
+} case_t;
+
+/* Defines the outcome of a case played by one engine. */
+typedef struct
+{
+    int turns;              /* Turns played before the game ended. */
+    int winner;             /* 0 while playing, then 'p' or 'e'. */
+    int height;             /* Size of the map, and of every frame. */
+    int width;
+    char** grid;            /* Final map. */
+    char*** frames;         /* Every logged frame, in order. */
+    size_t frame_count;
+    size_t frame_capacity;
+    char* log;              /* Bytes of the written log. */
+    size_t log_size;
+} result_t;
+
+/* Defines the settings of the run, from the command line. */
+typedef struct
+{
+    long cases;
+    unsigned long long seed;
+    const char* prefix;     /* Reproducer files are named after it. */
+    char log_filename[2][4096];
+} settings_t;
+
+/* Defines a game played before the random ones, in the map file format
+and as a move script. */
+typedef struct
+{
+    const char* map;
+    const char* script;
+} fixed_case_t;
+
+/* Games which once went wrong. */
+static const fixed_case_t FIXED_CASES[] =
+{
+    /* The first move bumps into the top wall. With --skip-repeats it is
+    still logged, since the log has no frame of the initial map. */
+    {"2 2\n0 0 u\n1 1 d\n", "w"}
+};
+
+/* Totals over the cases run. */
+static long total_frames, total_shots, total_lasers;
+
+/* Prints the usage of the program. */
+static void usage(const char* program)
+{
+    fprintf(stderr, "Usage: %s [--cases <n>] [--seed <n>] [--output <prefix>]\n", program);
+}
+
+/* Writes the map of a case in the map file format. */
+static void map_text(const case_t* test, char* text, size_t size)
+{
+    size_t length;
+    int k;
+
+    length = (size_t) snprintf(text, size, "%d %d\n", test->height, test->width);
+    for (k = 0; k < test->count && length < size; k++)
+    {
+        length += (size_t) snprintf(text + length, size - length, "%d %d %c\n",
+        test->x[k], test->y[k], test->dir[k]);
+    }
+}
+
+/* Returns true if a case is a valid map the game accepts. */
+static bool is_valid(const case_t* test)
+{
+    char text[MAP_TEXT_SIZE];
+    map_text(test, text, sizeof(text));
+    return check_map(text, strlen(text), 1, NULL, NULL) == 0;
+}
+
+/* Fills a case from a map in the map file format and a move script. */
+static void parse_case(case_t* test, const char* map, const char* script)
+{
+    int read;
+
+    sscanf(map, "%d%d%n", &test->height, &test->width, &read);
+    map += read;
+    for (test->count = 0; test->count < MAX_OBJECTS && sscanf(map, "%d%d %c%n",
+    &test->x[test->count], &test->y[test->count], &test->dir[test->count], &read) == 3;
+    test->count++)
+    {
+        map += read;
+    }
+    snprintf(test->script, sizeof(test->script), "%s", script);
+}
+
+/* Fills a case with a random map and script. */
+static void generate_case(case_t* test, unsigned long long* rng)
+{
+    bool taken[MAX_OBJECTS];
+    int cells, mirror_percent, length;
+    int c, k;
+
+    do
+    {
+        test->height = 1 + (int) (random_next(rng) % MAX_SIDE);
+        test->width = 1 + (int) (random_next(rng) % MAX_SIDE);
+    } while (test->height * test->width < 2);
+    cells = test->height * test->width;
+    memset(taken, 0, sizeof(taken));
+
+    /* Two tanks on distinct cells, then mirrors on free cells. */
+    mirror_percent = (int) (random_next(rng) % 50);
+    test->count = 0;
+    for (k = 0; k < 2; k++)
+    {
+        do
+        {
+            c = (int) (random_next(rng) % cells);
+        } while (taken[c]);
+        taken[c] = true;
+        test->x[k] = c / test->width;
+        test->y[k] = c % test->width;
+        test->dir[k] = "udlr"[random_next(rng) % 4];
+        test->count++;
+    }
+    for (c = 0; c < cells; c++)
+    {
+        if (!taken[c] && (int) (random_next(rng) % 100) < mirror_percent)
+        {
+            test->x[test->count] = c / test->width;
+            test->y[test->count] = c % test->width;
+            test->dir[test->count] = "fb"[random_next(rng) % 2];
+            test->count++;
+        }
+    }
+
+    /* Shots are as likely as moves in one direction. */
+    length = 1 + (int) (random_next(rng) % MAX_SCRIPT);
+    for (k = 0; k < length; k++)
+    {
+        test->script[k] = "wsadf"[random_next(rng) % 5];
+    }
+    test->script[length] = '\0';
+}
+
+/* Appends a copy of a frame to a result. */
+static void keep_frame(char** grid, void* context)
+{
+    result_t* result;
+    result = context;
+    if (result->frame_count == result->frame_capacity)
+    {
+        result->frame_capacity = result->frame_capacity ? result->frame_capacity * 2 : 64;
+        result->frames = realloc(result->frames, sizeof(char**) * result->frame_capacity);
+    }
+    result->frames[result->frame_count++] = get_copy(grid, result->height, result->width);
+}
+
+/* Reads back a written log. */
+static void read_log(result_t* result, const char* filename)
+{
+    FILE* file;
+    long size;
+
+    result->log = NULL;
+    result->log_size = 0;
+    file = fopen(filename, "rb");
+    if (!file)
+    {
+        return;
+    }
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    result->log = malloc(size > 0 ? (size_t) size : 1);
+    result->log_size = fread(result->log, 1, size > 0 ? (size_t) size : 0, file);
+    fclose(file);
+    remove(filename);
+}
+
+/* Plays a case with the engine under test, as main does with the
+classic enemy, leaving repeated frames out of the log if skip_repeats. */
+static void run_engine(const case_t* test, const settings_t* settings, bool skip_repeats,
+result_t* result)
+{
+    char text[MAP_TEXT_SIZE];
+    char** grid;
+    bool exit_flag;
+    pos_t previous_pos;
+    unsigned long long logged_hash;
+    FILE* map;
+    size_t k;
+    int height, width;
+
+    map_text(test, text, sizeof(text));
+    map = fmemopen(text, strlen(text), "r");
+    fscanf(map, "%d%d", &height, &width);
+    grid = create_map(height, width);
+    initialize_map(grid, height, width, map, &player_pos, &enemy_pos);
+    fclose(map);
+    grid_hash = hash_grid(grid, height, width);
+    result->height = height;
+    result->width = width;
+    start_event_log(&game_log, grid, height, width);
+    logged_hash = grid_hash;
+
+    exit_flag = false;
+    result->winner = 0;
+    for (result->turns = 0; test->script[result->turns]; result->turns++)
+    {
+        char choice;
+
+        if (in_line_of_sight(player_pos, enemy_pos, grid))
+        {
+            enemy_fire(&exit_flag, grid, height, width);
+        }
+        if (exit_flag)
+        {
+            result->winner = 'e';
+            break;
+        }
+
+        choice = test->script[result->turns];
+        previous_pos = player_pos;
+        if (choice == 'w')
+        {
+            go_or_face_upward(grid);
+        }
+        else if (choice == 's')
+        {
+            go_or_face_downward(grid, height);
+        }
+        else if (choice == 'd')
+        {
+            go_or_face_rightward(grid, width);
+        }
+        else if (choice == 'a')
+        {
+            go_or_face_leftward(grid);
+        }
+        else
+        {
+            player_fire(&exit_flag, grid, height, width);
+            if (exit_flag)
+            {
+                result->winner = 'p';
+                result->turns++;
+                break;
+            }
+            continue;
+        }
+        if (!skip_repeats || !repeats_last_frame(&game_log, grid_hash, logged_hash))
+        {
+            log_move(&game_log, previous_pos, player_pos, grid[player_pos.x][player_pos.y]);
+            logged_hash = grid_hash;
+        }
+    }
+    result->grid = grid;
+
+    for (k = 0; !skip_repeats && k < game_log.count; k++)
+    {
+        total_shots += game_log.events[k].type == EVENT_SHOT;
+    }
+    expand_events(&game_log, keep_frame, result);
+    write_event_log(&game_log, settings->log_filename[1]);
+    read_log(result, settings->log_filename[1]);
+    free_event_log(&game_log);
+}
+
+/* Plays a case with the reference engine. */
+static void run_reference(const case_t* test, const settings_t* settings, result_t* result)
+{
+    char text[MAP_TEXT_SIZE];
+    reference_t ref;
+    reference_frame_t* frame;
+    bool exit_flag;
+    FILE* map;
+
+    map_text(test, text, sizeof(text));
+    map = fmemopen(text, strlen(text), "r");
+    reference_start(&ref, map);
+    fclose(map);
+    result->height = ref.height;
+    result->width = ref.width;
+
+    exit_flag = false;
+    result->winner = 0;
+    for (result->turns = 0; test->script[result->turns]; result->turns++)
+    {
+        char choice;
+
+        if (reference_in_line_of_sight(ref.player_pos, ref.enemy_pos, ref.grid))
+        {
+            reference_enemy_fire(&ref, &exit_flag);
+        }
+        if (exit_flag)
+        {
+            result->winner = 'e';
+            break;
+        }
+
+        choice = test->script[result->turns];
+        if (choice == 'w')
+        {
+            reference_go_or_face_upward(&ref);
+        }
+        else if (choice == 's')
+        {
+            reference_go_or_face_downward(&ref);
+        }
+        else if (choice == 'd')
+        {
+            reference_go_or_face_rightward(&ref);
+        }
+        else if (choice == 'a')
+        {
+            reference_go_or_face_leftward(&ref);
+        }
+        else
+        {
+            reference_player_fire(&ref, &exit_flag);
+            if (exit_flag)
+            {
+                result->winner = 'p';
+                result->turns++;
+                break;
+            }
+        }
+    }
+
+    /* Hand the grid and frames over to the result. */
+    result->grid = get_copy(ref.grid, ref.height, ref.width);
+    for (frame = ref.game_log; frame != NULL; frame = frame->next)
+    {
+        keep_frame(frame->grid, result);
+    }
+    reference_write_list(&ref, settings->log_filename[0]);
+    read_log(result, settings->log_filename[0]);
+    reference_free(&ref);
+}
+
+/* Frees heap memory associated with a result. */
+static void free_result(result_t* result, int height)
+{
+    size_t k;
+    for (k = 0; k < result->frame_count; k++)
+    {
+        delete_map(result->frames[k], height);
+    }
+    delete_map(result->grid, height);
+    free(result->frames);
+    free(result->log);
+    memset(result, 0, sizeof(*result));
+}
+
+/* Returns true if two grids are the same, describing the first
+different cell otherwise. */
+static bool same_grid(char** expected, char** actual, int height, int width,
+const char* what, char* mismatch)
+{
+    int i, j;
+    for (i = 0; i < height; i++)
+    {
+        for (j = 0; j < width; j++)
+        {
+            if (expected[i][j] != actual[i][j])
+            {
+                snprintf(mismatch, MISMATCH_SIZE, "%s differs at %d %d: '%c' expected, "
+                "'%c' found", what, i, j, expected[i][j], actual[i][j]);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/* Returns true if a frame shows a laser. */
+static bool has_laser(char** grid, int height, int width)
+{
+    int i, j;
+    for (i = 0; i < height; i++)
+    {
+        for (j = 0; j < width; j++)
+        {
+            if (grid[i][j] == '|' || grid[i][j] == '-')
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/* Leaves out of a result the move frames which repeat the frame before
+them, as --skip-repeats does. Laser frames are kept even when a shot
+repeats the one before it. */
+static void drop_repeats(result_t* result, int height, int width)
+{
+    size_t k, kept;
+    char mismatch[MISMATCH_SIZE];
+
+    kept = 0;
+    for (k = 0; k < result->frame_count; k++)
+    {
+        if (kept > 0 && !has_laser(result->frames[k], height, width)
+        && same_grid(result->frames[kept - 1], result->frames[k], height, width, "frame",
+        mismatch))
+        {
+            delete_map(result->frames[k], height);
+        }
+        else
+        {
+            result->frames[kept++] = result->frames[k];
+        }
+    }
+    result->frame_count = kept;
+}
+
+/* Returns true if the engine played a case as the reference did,
+describing the first difference otherwise. Log bytes are only compared
+if compare_log. */
+static bool same_result(const result_t* expected, const result_t* actual, const case_t* test,
+bool compare_log, char* mismatch)
+{
+    char what[64];
+    bool same;
+    size_t k;
+
+    /* Outcome, then frames from the first, the final map and the log bytes. */
+    if (expected->winner != actual->winner || expected->turns != actual->turns)
+    {
+        snprintf(mismatch, MISMATCH_SIZE, "outcome differs: %s after %d turn(s) expected, "
+        "%s after %d turn(s) found",
+        expected->winner == 'p' ? "player won" : (expected->winner ? "enemy won" : "no winner"),
+        expected->turns,
+        actual->winner == 'p' ? "player won" : (actual->winner ? "enemy won" : "no winner"),
+        actual->turns);
+        return false;
+    }
+    same = true;
+    for (k = 0; same && k < expected->frame_count && k < actual->frame_count; k++)
+    {
+        snprintf(what, sizeof(what), "frame %zu", k + 1);
+        same = same_grid(expected->frames[k], actual->frames[k], test->height,
+        test->width, what, mismatch);
+    }
+    if (same && expected->frame_count != actual->frame_count)
+    {
+        snprintf(mismatch, MISMATCH_SIZE, "%zu frame(s) expected, %zu found",
+        expected->frame_count, actual->frame_count);
+        same = false;
+    }
+    same = same && same_grid(expected->grid, actual->grid, test->height, test->width,
+    "final map", mismatch);
+    for (k = 0; same && compare_log && k < expected->log_size && k < actual->log_size; k++)
+    {
+        if (expected->log[k] != actual->log[k])
+        {
+            snprintf(mismatch, MISMATCH_SIZE, "log differs from byte %zu", k);
+            same = false;
+        }
+    }
+    if (same && compare_log && expected->log_size != actual->log_size)
+    {
+        snprintf(mismatch, MISMATCH_SIZE, "log of %zu byte(s) expected, %zu found",
+        expected->log_size, actual->log_size);
+        same = false;
+    }
+    return same;
+}
+
+/* Step budgets lasers are checked with; 0 is none. */
+static const long LASER_BUDGETS[] = {0, 1, 2, 3, 5, 8, 13};
+
+/* Fires a laser from every free cell in every direction at each tank of a
+case's map, without a step budget and with each of LASER_BUDGETS, and
+checks that the tracer, the compact state, the kill map and the editor
+agree on whether it hits. Returns true if they do, describing the first
+laser they disagree on otherwise. */
+static bool check_lasers(const case_t* test, char* mismatch)
+{
+    static const char DIRS[] = {'u', 'd', 'l', 'r'};
+    size_t b;
+    char text[MAP_TEXT_SIZE];
+    char** grid;
+    board_t board;
+    game_state_t state;
+    kill_map_t kill_map;
+    beam_tracer_t tracer;
+    editor_t editor;
+    pos_t player, enemy;
+    FILE* map;
+    bool same;
+    int height, width;
+    int t, i, j, d;
+
+    map_text(test, text, sizeof(text));
+    map = fmemopen(text, strlen(text), "r");
+    fscanf(map, "%d%d", &height, &width);
+    grid = create_map(height, width);
+    initialize_map(grid, height, width, map, &player, &enemy);
+    fclose(map);
+
+    board_from_grid(&board, grid, height, width);
+    create_kill_map(&kill_map, height, width);
+    memset(&tracer, 0, sizeof(tracer));
+    start_editor(&editor, grid, height, width, &player, &enemy);
+
+    same = true;
+    for (b = 0; b < sizeof(LASER_BUDGETS) / sizeof(LASER_BUDGETS[0]) && same; b++)
+    for (t = 0; t < 2 && same; t++)
+    {
+        pos_t target;
+
+        beam_step_budget = LASER_BUDGETS[b];
+        target = t == 0 ? enemy : player;
+        compute_kill_map(&kill_map, grid, target);
+        state.tanks[TANK_ENEMY].pos = target;
+        for (i = 0; i < height && same; i++)
+        {
+            for (j = 0; j < width && same; j++)
+            {
+                pos_t shooter;
+
+                shooter.x = i;
+                shooter.y = j;
+                if (is_mirror(grid[i][j]) || (i == target.x && j == target.y))
+                {
+                    continue;
+                }
+                state.tanks[TANK_PLAYER].pos = shooter;
+                for (d = 0; d < 4 && same; d++)
+                {
+                    bool traced, compact, killed, edited;
+
+                    traced = trace_beam(&tracer, grid, height, width, shooter, DIRS[d],
+                    target) == BEAM_TARGET;
+                    compact = state_shot_hits(&board, &state, TANK_PLAYER, DIRS[d]);
+                    killed = kill_map_hits(&kill_map, i, j, DIRS[d]);
+                    edited = edit_shot_hits(&editor, shooter, DIRS[d], target);
+                    total_lasers++;
+                    if (traced != compact || traced != killed || traced != edited)
+                    {
+                        snprintf(mismatch, MISMATCH_SIZE, "laser from (%d, %d) going %c at "
+                        "(%d, %d) with a budget of %ld steps: trace_beam %s, "
+                        "state_shot_hits %s, kill map %s, editor %s", i, j, DIRS[d],
+                        target.x, target.y, beam_step_budget, traced ? "hits" : "misses",
+                        compact ? "hits" : "misses", killed ? "hits" : "misses",
+                        edited ? "hits" : "misses");
+                        same = false;
+                    }
+                }
+            }
+        }
+    }
+
+    beam_step_budget = 0;
+    free_editor(&editor);
+    free_beam_tracer(&tracer);
+    free_kill_map(&kill_map);
+    free_board(&board);
+    delete_map(grid, height);
+    return same;
+}
+
+/* Checks the lasers of a case's map, then plays the case with both
+engines, and once more with the engine leaving repeated frames out, as
+--skip-repeats does; the reference log without its repeated frames is
+then expected. Returns true if everything agrees, describing the first
+difference otherwise. */
+static bool play_case(const case_t* test, const settings_t* settings, char* mismatch)
+{
+    result_t expected, actual;
+    char found[MISMATCH_SIZE];
+    bool same;
+
+    if (!check_lasers(test, mismatch))
+    {
+        return false;
+    }
+
+    memset(&expected, 0, sizeof(expected));
+    memset(&actual, 0, sizeof(actual));
+    run_reference(test, settings, &expected);
+    run_engine(test, settings, false, &actual);
+    total_frames += (long) expected.frame_count;
+    same = same_result(&expected, &actual, test, true, mismatch);
+    free_result(&actual, test->height);
+
+    if (same)
+    {
+        drop_repeats(&expected, test->height, test->width);
+        run_engine(test, settings, true, &actual);
+        same = same_result(&expected, &actual, test, false, found);
+        if (!same)
+        {
+            snprintf(mismatch, MISMATCH_SIZE, "with --skip-repeats, %.200s", found);
+        }
+        free_result(&actual, test->height);
+    }
+    free_result(&expected, test->height);
+    return same;
+}
+
+/* Removes object k from a case. */
+static void remove_object(case_t* test, int k)
+{
+    memmove(&test->x[k], &test->x[k + 1], sizeof(int) * (test->count - k - 1));
+    memmove(&test->y[k], &test->y[k + 1], sizeof(int) * (test->count - k - 1));
+    memmove(&test->dir[k], &test->dir[k + 1], test->count - k - 1);
+    test->count--;
+}
+
+/* Tries a smaller case in place of a failing one. Keeps it if it is valid
+and still fails. */
+static bool try_smaller(case_t* test, const case_t* candidate, const settings_t* settings,
+char* mismatch)
+{
+    char found[MISMATCH_SIZE];
+    if (!is_valid(candidate) || play_case(candidate, settings, found))
+    {
+        return false;
+    }
+    *test = *candidate;
+    strcpy(mismatch, found);
+    return true;
+}
+
+/* Shrinks a failing case until no single step makes it smaller: dropping
+parts of the script, dropping mirrors, and cutting off map edges. */
+static void shrink_case(case_t* test, const settings_t* settings, char* mismatch)
+{
+    case_t candidate;
+    bool progress;
+    int chunk, start, length, k;
+
+    do
+    {
+        progress = false;
+
+        /* Script: halves, quarters, ... down to single turns. */
+        length = (int) strlen(test->script);
+        for (chunk = length / 2; chunk >= 1; chunk /= 2)
+        {
+            for (start = 0; start + chunk <= (int) strlen(test->script); )
+            {
+                candidate = *test;
+                memmove(candidate.script + start, candidate.script + start + chunk,
+                strlen(candidate.script + start + chunk) + 1);
+                if (candidate.script[0] && try_smaller(test, &candidate, settings, mismatch))
+                {
+                    progress = true;
+                }
+                else
+                {
+                    start += chunk;
+                }
+            }
+        }
+
+        /* Mirrors, one at a time. */
+        for (k = test->count - 1; k >= 2; k--)
+        {
+            candidate = *test;
+            remove_object(&candidate, k);
+            progress = try_smaller(test, &candidate, settings, mismatch) || progress;
+        }
+
+        /* Edges: last row, last column, first row, first column. */
+        candidate = *test;
+        candidate.height--;
+        progress = try_smaller(test, &candidate, settings, mismatch) || progress;
+        candidate = *test;
+        candidate.width--;
+        progress = try_smaller(test, &candidate, settings, mismatch) || progress;
+        candidate = *test;
+        candidate.height--;
+        for (k = 0; k < candidate.count; k++)
+        {
+            candidate.x[k]--;
+        }
+        progress = try_smaller(test, &candidate, settings, mismatch) || progress;
+        candidate = *test;
+        candidate.width--;
+        for (k = 0; k < candidate.count; k++)
+        {
+            candidate.y[k]--;
+        }
+        progress = try_smaller(test, &candidate, settings, mismatch) || progress;
+    } while (progress);
+}
+
+/* Writes the map and script of a case to files named after prefix, and
+prints them. */
+static void write_reproducer(const case_t* test, const char* prefix, FILE* stream)
+{
+    char text[MAP_TEXT_SIZE];
+    char filename[4096];
+    FILE* outfile;
+    size_t k;
+
+    map_text(test, text, sizeof(text));
+    fprintf(stream, "Map:\n%sScript: %s\n", text, test->script);
+
+    snprintf(filename, sizeof(filename), "%smap.txt", prefix);
+    outfile = fopen(filename, "w");
+    if (! outfile)
+    {
+        fprintf(stderr, "Couldn't open %s for writing.\n", filename);
+        return;
+    }
+    fputs(text, outfile);
+    fclose(outfile);
+    fprintf(stream, "Written to %s", filename);
+
+    /* One move per line, as laserTank reads them from its input. */
+    snprintf(filename, sizeof(filename), "%sscript.txt", prefix);
+    outfile = fopen(filename, "w");
+    if (! outfile)
+    {
+        fprintf(stderr, "Couldn't open %s for writing.\n", filename);
+        return;
+    }
+    for (k = 0; test->script[k]; k++)
+    {
+        fprintf(outfile, "%c\n", test->script[k]);
+    }
+    fclose(outfile);
+    fprintf(stream, " and %s\n", filename);
+}
+
+/* Plays random games with the game engine and the frozen reference engine
+and checks that they log the same games. */
+int main(int argc, char** argv)
+{
+    settings_t settings;
+    case_t test;
+    char mismatch[MISMATCH_SIZE];
+    unsigned long long rng;
+    const char* temp_dir;
+    long long start, elapsed;
+    FILE* report;
+    long n, fixed;
+    int i;
+
+    settings.cases = 300;
+    settings.seed = 1;
+    settings.prefix = "difftest.";
+
+    /* Parse options. */
+    for (i = 1; i < argc; i += 2)
+    {
+        if (i + 1 >= argc)
+        {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        if (strcmp(argv[i], "--cases") == 0)
+        {
+            settings.cases = strtol(argv[i + 1], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--seed") == 0)
+        {
+            settings.seed = strtoull(argv[i + 1], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--output") == 0)
+        {
+            settings.prefix = argv[i + 1];
+        }
+        else
+        {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (settings.cases <= 0)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    /* Both engines write their log, which is then read back. */
+    temp_dir = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+    snprintf(settings.log_filename[0], sizeof(settings.log_filename[0]),
+    "%s/difftest.%ld.reference", temp_dir, (long) getpid());
+    snprintf(settings.log_filename[1], sizeof(settings.log_filename[1]),
+    "%s/difftest.%ld.engine", temp_dir, (long) getpid());
+
+    /* The engine draws every laser step on stdout; keep that out of the
+    report. */
+    fflush(stdout);
+    report = fdopen(dup(STDOUT_FILENO), "w");
+    if (!report || !freopen("/dev/null", "w", stdout))
+    {
+        fprintf(stderr, "Couldn't redirect the output of the engine.\n");
+        return EXIT_FAILURE;
+    }
+
+    rng = settings.seed * 0x9E3779B97F4A7C15ULL + 1;
+    start = usec_now();
+    fixed = sizeof(FIXED_CASES) / sizeof(FIXED_CASES[0]);
+    for (n = 0; n < fixed + settings.cases; n++)
+    {
+        if (n < fixed)
+        {
+            parse_case(&test, FIXED_CASES[n].map, FIXED_CASES[n].script);
+        }
+        else
+        {
+            generate_case(&test, &rng);
+        }
+        if (!play_case(&test, &settings, mismatch))
+        {
+            if (n < fixed)
+            {
+                fprintf(report, "Fixed case %ld: %s\n", n + 1, mismatch);
+            }
+            else
+            {
+                fprintf(report, "Case %ld of seed %llu: %s\n", n - fixed + 1, settings.seed,
+                mismatch);
+            }
+            shrink_case(&test, &settings, mismatch);
+            fprintf(report, "Shrunk to: %s\n", mismatch);
+            write_reproducer(&test, settings.prefix, report);
+            fclose(report);
+            return EXIT_FAILURE;
+        }
+    }
+    elapsed = usec_now() - start;
+
+    fprintf(report, "%ld case(s), %ld frame(s), %ld shot(s): the engine matches the "
+    "reference\n", fixed + settings.cases, total_frames, total_shots);
+    fprintf(report, "%ld laser(s): the tracer, the compact state, the kill map and the "
+    "editor agree\n", total_lasers);
+    fprintf(stderr, "%ld case(s) in %.3f s (%.0f cases/s)\n", fixed + settings.cases,
+    elapsed / 1e6, (fixed + settings.cases) / (elapsed > 0 ? elapsed / 1e6 : 1e-6));
+    fclose(report);
+    return EXIT_SUCCESS;
+}
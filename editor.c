@@ -0,0 +1,462 @@
+#include "editor.h"
+#include <stdlib.h>
+#include "beam.h"
+#include "sleep.h"
+#include "viewport.h"
+#include "zobrist.h"
+
+/* Index of a cell in the segment arrays. */
+#define CELL(segments, x, y) ((size_t) (x) * (segments)->width + (y))
+
+/* Returns true if the cell at (x, y) lets a laser through. */
+static bool is_free(const editor_t* editor, int x, int y)
+{
+    return !is_mirror(editor->grid[x][y]);
+}
+
+/* Sets the row run bounds of the cells in columns [begin, end] of row x. */
+static void set_row_run(segments_t* segments, int x, int begin, int end)
+{
+    int j;
+    for (j = begin; j <= end; j++)
+    {
+        segments->left[CELL(segments, x, j)] = begin;
+        segments->right[CELL(segments, x, j)] = end;
+    }
+}
+
+/* Sets the column run bounds of the cells in rows [begin, end] of column y. */
+static void set_column_run(segments_t* segments, int y, int begin, int end)
+{
+    int i;
+    for (i = begin; i <= end; i++)
+    {
+        segments->top[CELL(segments, i, y)] = begin;
+        segments->bottom[CELL(segments, i, y)] = end;
+    }
+}
+
+/* Recomputes the row run and the column run through (x, y) after the
+cell turned into a mirror or stopped being one. */
+static void update_runs(editor_t* editor, int x, int y)
+{
+    segments_t* segments;
+    int begin, end;
+
+    segments = &editor->segments;
+    if (!is_free(editor, x, y))
+    {
+        /* A new mirror splits the runs it lands on. */
+        begin = segments->left[CELL(segments, x, y)];
+        end = segments->right[CELL(segments, x, y)];
+        if (begin < y)
+        {
+            set_row_run(segments, x, begin, y - 1);
+        }
+        if (y < end)
+        {
+            set_row_run(segments, x, y + 1, end);
+        }
+        set_row_run(segments, x, y, y);
+
+        begin = segments->top[CELL(segments, x, y)];
+        end = segments->bottom[CELL(segments, x, y)];
+        if (begin < x)
+        {
+            set_column_run(segments, y, begin, x - 1);
+        }
+        if (x < end)
+        {
+            set_column_run(segments, y, x + 1, end);
+        }
+        set_column_run(segments, y, x, x);
+    }
+    else
+    {
+        /* A removed mirror merges the runs on either side of it. */
+        begin = (y > 0 && is_free(editor, x, y - 1))
+        ? segments->left[CELL(segments, x, y - 1)] : y;
+        end = (y < editor->width - 1 && is_free(editor, x, y + 1))
+        ? segments->right[CELL(segments, x, y + 1)] : y;
+        set_row_run(segments, x, begin, end);
+
+        begin = (x > 0 && is_free(editor, x - 1, y))
+        ? segments->top[CELL(segments, x - 1, y)] : x;
+        end = (x < editor->height - 1 && is_free(editor, x + 1, y))
+        ? segments->bottom[CELL(segments, x + 1, y)] : x;
+        set_column_run(segments, y, begin, end);
+    }
+}
+
+void start_editor(editor_t* editor, char** grid, int height, int width,
+pos_t* player, pos_t* enemy)
+{
+    segments_t* segments;
+    size_t cells;
+    int i, j;
+
+    editor->grid = grid;
+    editor->height = height;
+    editor->width = width;
+    editor->player = player;
+    editor->enemy = enemy;
+
+    segments = &editor->segments;
+    cells = (size_t) height * width;
+    segments->height = height;
+    segments->width = width;
+    segments->left = malloc(sizeof(int) * (cells > 0 ? cells : 1));
+    segments->right = malloc(sizeof(int) * (cells > 0 ? cells : 1));
+    segments->top = malloc(sizeof(int) * (cells > 0 ? cells : 1));
+    segments->bottom = malloc(sizeof(int) * (cells > 0 ? cells : 1));
+
+    /* Row runs. */
+    for (i = 0; i < height; i++)
+    {
+        int begin;
+        begin = 0;
+        for (j = 0; j <= width; j++)
+        {
+            if (j == width || !is_free(editor, i, j))
+            {
+                if (begin < j)
+                {
+                    set_row_run(segments, i, begin, j - 1);
+                }
+                if (j < width)
+                {
+                    set_row_run(segments, i, j, j);
+                }
+                begin = j + 1;
+            }
+        }
+    }
+
+    /* Column runs. */
+    for (j = 0; j < width; j++)
+    {
+        int begin;
+        begin = 0;
+        for (i = 0; i <= height; i++)
+        {
+            if (i == height || !is_free(editor, i, j))
+            {
+                if (begin < i)
+                {
+                    set_column_run(segments, j, begin, i - 1);
+                }
+                if (i < height)
+                {
+                    set_column_run(segments, j, i, i);
+                }
+                begin = i + 1;
+            }
+        }
+    }
+}
+
+void free_editor(editor_t* editor)
+{
+    free(editor->segments.left);
+    free(editor->segments.right);
+    free(editor->segments.top);
+    free(editor->segments.bottom);
+    editor->segments.left = NULL;
+    editor->segments.right = NULL;
+    editor->segments.top = NULL;
+    editor->segments.bottom = NULL;
+}
+
+/* Returns true if (x, y) is inside the map. */
+static bool in_map(const editor_t* editor, int x, int y)
+{
+    return x >= 0 && x < editor->height && y >= 0 && y < editor->width;
+}
+
+bool edit_add_mirror(editor_t* editor, int x, int y, char dir)
+{
+    if (!in_map(editor, x, y) || editor->grid[x][y] != ' ' || (dir != 'f' && dir != 'b'))
+    {
+        return false;
+    }
+    set_cell(editor->grid, x, y, get_mirror(dir));
+    update_runs(editor, x, y);
+    return true;
+}
+
+bool edit_remove_mirror(editor_t* editor, int x, int y)
+{
+    if (!in_map(editor, x, y) || !is_mirror(editor->grid[x][y]))
+    {
+        return false;
+    }
+    set_cell(editor->grid, x, y, ' ');
+    update_runs(editor, x, y);
+    return true;
+}
+
+bool edit_flip_mirror(editor_t* editor, int x, int y)
+{
+    if (!in_map(editor, x, y) || !is_mirror(editor->grid[x][y]))
+    {
+        return false;
+    }
+
+    /* The runs don't change: the cell stays a mirror. */
+    set_cell(editor->grid, x, y, get_mirror(get_mirror_dir(editor->grid[x][y]) == 'f' ? 'b' : 'f'));
+    return true;
+}
+
+bool edit_move_tank(editor_t* editor, pos_t* tank, pos_t to)
+{
+    if (!in_map(editor, to.x, to.y) || editor->grid[to.x][to.y] != ' ')
+    {
+        return false;
+    }
+
+    /* Tanks don't stop lasers in general, so the runs don't change. */
+    set_cell(editor->grid, to.x, to.y, editor->grid[tank->x][tank->y]);
+    set_cell(editor->grid, tank->x, tank->y, ' ');
+    *tank = to;
+    return true;
+}
+
+/* Finds the last free cell a laser leaving from in direction dir crosses
+before it hits a mirror or the edge of the map. Returns false if the
+laser hits a mirror or the edge right away. */
+static bool run_end(const editor_t* editor, pos_t from, char dir, pos_t* end)
+{
+    const segments_t* segments;
+    pos_t next;
+
+    segments = &editor->segments;
+    next = from;
+    advance_laser(&next, dir);
+    if (!in_map(editor, next.x, next.y) || !is_free(editor, next.x, next.y))
+    {
+        return false;
+    }
+
+    *end = next;
+    switch (dir)
+    {
+        case 'u': end->x = segments->top[CELL(segments, next.x, next.y)]; break;
+        case 'd': end->x = segments->bottom[CELL(segments, next.x, next.y)]; break;
+        case 'l': end->y = segments->left[CELL(segments, next.x, next.y)]; break;
+        case 'r': end->y = segments->right[CELL(segments, next.x, next.y)]; break;
+    }
+    return true;
+}
+
+/* Returns the distance between two cells on a row or column. */
+static int distance(pos_t a, pos_t b)
+{
+    return abs(a.x - b.x) + abs(a.y - b.y);
+}
+
+/* Returns true if target lies strictly after from and no later than end
+on the straight line from from to end. */
+static bool crosses(pos_t from, pos_t end, pos_t target)
+{
+    if (from.x == end.x && target.x == from.x)
+    {
+        return (from.y < target.y && target.y <= end.y)
+        || (end.y <= target.y && target.y < from.y);
+    }
+    if (from.y == end.y && target.y == from.y)
+    {
+        return (from.x < target.x && target.x <= end.x)
+        || (end.x <= target.x && target.x < from.x);
+    }
+    return false;
+}
+
+bool edit_shot_hits(const editor_t* editor, pos_t from, char dir, pos_t target)
+{
+    pos_t laser_pos;
+    char laser_dir;
+    long hops, max_hops;
+    long taken;     /* Steps the laser took, as trace_beam counts them. */
+
+    laser_pos = from;
+    laser_dir = dir;
+    taken = 0;
+
+    /* A laser enters each mirror at most once from each side; past that
+    it is going around in circles. */
+    max_hops = 4L * editor->height * editor->width + 1;
+    for (hops = 0; hops < max_hops; hops++)
+    {
+        pos_t end;
+
+        /* Cross the run of free cells ahead, if any; the laser stops at
+        whichever tank it reaches first. */
+        if (run_end(editor, laser_pos, laser_dir, &end))
+        {
+            bool hits_target, hits_self;
+            hits_target = crosses(laser_pos, end, target);
+            hits_self = crosses(laser_pos, end, from);
+            if (hits_target && hits_self)
+            {
+                hits_target = distance(laser_pos, target) < distance(laser_pos, from);
+            }
+            if (hits_target || hits_self)
+            {
+                return hits_target && (beam_step_budget <= 0
+                || taken + distance(laser_pos, target) <= beam_step_budget);
+            }
+            taken += distance(laser_pos, end);
+            laser_pos = end;
+        }
+        if (beam_step_budget > 0 && taken >= beam_step_budget)
+        {
+            return false;
+        }
+
+        /* Then either leave the map or turn on the mirror. */
+        advance_laser(&laser_pos, laser_dir);
+        if (!in_map(editor, laser_pos.x, laser_pos.y))
+        {
+            return false;
+        }
+        laser_dir = reflect_laser(laser_dir, editor->grid[laser_pos.x][laser_pos.y]);
+        taken++;
+    }
+    return false;
+}
+
+bool edit_in_line_of_sight(const editor_t* editor, pos_t from, char dir, pos_t target)
+{
+    pos_t end;
+    return run_end(editor, from, dir, &end) && crosses(from, end, target);
+}
+
+void write_map_file(const editor_t* editor, FILE* stream)
+{
+    int i, j;
+
+    fprintf(stream, "%d %d\n", editor->height, editor->width);
+    fprintf(stream, "%d %d %c\n", editor->player->x, editor->player->y,
+    get_player_dir(editor->grid[editor->player->x][editor->player->y]));
+    fprintf(stream, "%d %d %c\n", editor->enemy->x, editor->enemy->y,
+    get_player_dir(editor->grid[editor->enemy->x][editor->enemy->y]));
+    for (i = 0; i < editor->height; i++)
+    {
+        for (j = 0; j < editor->width; j++)
+        {
+            if (is_mirror(editor->grid[i][j]))
+            {
+                fprintf(stream, "%d %d %c\n", i, j, get_mirror_dir(editor->grid[i][j]));
+            }
+        }
+    }
+}
+
+/* Saves the map, reporting failure on stderr. */
+static void save(const editor_t* editor, const char* filename)
+{
+    FILE* outfile;
+    outfile = fopen(filename, "w");
+    if (! outfile)
+    {
+        fprintf(stderr, "Couldn't open %s for writing.\n", filename);
+        return;
+    }
+    write_map_file(editor, outfile);
+    fclose(outfile);
+}
+
+void run_editor(editor_t* editor, const char* filename)
+{
+    /* Cell of the last edit, kept in view. */
+    pos_t focus;
+
+    /* Outcome and duration of the last edit. */
+    const char* status;
+    long long elapsed;
+
+    focus = *editor->player;
+    status = "ready";
+    elapsed = 0;
+    while (true)
+    {
+        char command;
+        pos_t cell;
+        char dir;
+        long long start;
+        pos_t player, enemy;
+
+        player = *editor->player;
+        enemy = *editor->enemy;
+
+        system("clear");
+        draw_view(editor->grid, editor->height, editor->width, focus, player, enemy,
+        stdout);
+        fprintf(stdout, "%s (%lld us)\n", status, elapsed);
+        fprintf(stdout, "enemy hits player: %s, player hits enemy: %s\n",
+        edit_shot_hits(editor, enemy, get_player_dir(editor->grid[enemy.x][enemy.y]), player)
+        ? "yes" : "no",
+        edit_shot_hits(editor, player, get_player_dir(editor->grid[player.x][player.y]), enemy)
+        ? "yes" : "no");
+        fprintf(stdout, "m x y f/b: add mirror, r x y: remove mirror, t x y: flip mirror\n");
+        fprintf(stdout, "p x y: move player, e x y: move enemy, s: save, q: save and quit\n");
+        fprintf(stdout, "edit: ");
+
+        if (fscanf(stdin, " %c", &command) != 1 || command == 'q')
+        {
+            break;
+        }
+        if (command == 's')
+        {
+            save(editor, filename);
+            status = "saved";
+            elapsed = 0;
+            continue;
+        }
+        if (fscanf(stdin, "%d%d", &cell.x, &cell.y) != 2)
+        {
+            status = "expected a row and a column";
+            continue;
+        }
+        if (command == 'm' && fscanf(stdin, " %c", &dir) != 1)
+        {
+            status = "expected a mirror direction";
+            continue;
+        }
+
+        /* Time the edit itself, runs included, once all its input is read. */
+        start = usec_now();
+        switch (command)
+        {
+            case 'm':
+                status = edit_add_mirror(editor, cell.x, cell.y, dir)
+                ? "mirror added" : "can't add a mirror there";
+                break;
+            case 'r':
+                status = edit_remove_mirror(editor, cell.x, cell.y)
+                ? "mirror removed" : "no mirror there";
+                break;
+            case 't':
+                status = edit_flip_mirror(editor, cell.x, cell.y)
+                ? "mirror flipped" : "no mirror there";
+                break;
+            case 'p':
+                status = edit_move_tank(editor, editor->player, cell)
+                ? "player moved" : "can't move the player there";
+                break;
+            case 'e':
+                status = edit_move_tank(editor, editor->enemy, cell)
+                ? "enemy moved" : "can't move the enemy there";
+                break;
+            default:
+                status = "unknown command";
+                break;
+        }
+        elapsed = usec_now() - start;
+        if (in_map(editor, cell.x, cell.y))
+        {
+            focus = cell;
+        }
+    }
+    save(editor, filename);
+}
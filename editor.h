@@ -0,0 +1,98 @@
+#ifndef EDITOR_H
+#define EDITOR_H
+#include <stdio.h>
+#include <stdbool.h>
+#include "utils.h"
+
+/* Live map editing.
+ *
+ * The editor keeps, for every cell, the bounds of the run of mirror-free
+ * cells around it along its row and along its column. A laser crosses a
+ * whole run in one step, so tracing costs one step per mirror hit, and
+ * adding or removing a mirror only splits or merges the one row run and
+ * the one column run through its cell. */
+
+/** Defines the row and column runs of a map. For a free cell, left/right
+ * are the first and last column of its row run and top/bottom the first
+ * and last row of its column run. For a mirror cell they are the cell
+ * itself. */
+typedef struct
+{
+    int height;
+    int width;
+    int* left;
+    int* right;
+    int* top;
+    int* bottom;
+} segments_t;
+
+/** Defines a map being edited. The grid and the tank positions are owned
+ * by the caller and updated in place. */
+typedef struct
+{
+    char** grid;
+    int height;
+    int width;
+    pos_t* player;
+    pos_t* enemy;
+    segments_t segments;
+} editor_t;
+
+/** Starts editing a map. Takes O(height * width) once.
+ * @param editor editor to start.
+ * @param grid pointer to the 2D array of characters representing the map.
+ * @param height number of rows in the grid.
+ * @param width number of columns in the grid.
+ * @param player position of the player tank.
+ * @param enemy position of the enemy tank. */
+void start_editor(editor_t* editor, char** grid, int height, int width,
+pos_t* player, pos_t* enemy);
+
+/** Frees heap memory associated with an editor. The map is left alone.
+ * @param editor editor started by start_editor. */
+void free_editor(editor_t* editor);
+
+/** Puts a mirror on an empty cell.
+ * @param dir direction of the mirror (f/b), as taken by get_mirror.
+ * @return true on success, false if the cell is outside the map or not empty. */
+bool edit_add_mirror(editor_t* editor, int x, int y, char dir);
+
+/** Removes a mirror.
+ * @return true on success, false if there is no mirror at the cell. */
+bool edit_remove_mirror(editor_t* editor, int x, int y);
+
+/** Turns a forward mirror into a backward one and vice versa.
+ * @return true on success, false if there is no mirror at the cell. */
+bool edit_flip_mirror(editor_t* editor, int x, int y);
+
+/** Moves a tank, keeping the direction it faces.
+ * @param tank editor->player or editor->enemy.
+ * @param to new position of the tank.
+ * @return true on success, false if the new cell is outside the map
+ * or not empty. */
+bool edit_move_tank(editor_t* editor, pos_t* tank, pos_t to);
+
+/** Returns true if a laser fired from a cell in a given direction hits
+ * a target cell before coming back to the cell it was fired from or
+ * running out of beam_step_budget. Takes one step per mirror on the
+ * laser's path.
+ * @param from cell the laser is fired from.
+ * @param dir direction the laser leaves from in (u/d/l/r).
+ * @param target cell of the target tank. */
+bool edit_shot_hits(const editor_t* editor, pos_t from, char dir, pos_t target);
+
+/** Returns true if a target cell lies straight ahead of a cell in a given
+ * direction with no mirror in between. Takes constant time. */
+bool edit_in_line_of_sight(const editor_t* editor, pos_t from, char dir, pos_t target);
+
+/** Writes a map in the map file format read by initialize_map.
+ * @param editor editor of the map.
+ * @param stream file stream where the map is to be written. */
+void write_map_file(const editor_t* editor, FILE* stream);
+
+/** Runs the interactive editor on stdin/stdout until the user quits.
+ * @param editor editor of the map.
+ * @param filename filename of the file where the map is saved. */
+void run_editor(editor_t* editor, const char* filename);
+
+#endif  /* EDITOR_H */
@@ -0,0 +1,224 @@
+#include "eventlog.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include "linkedlist.h"
+#include "logcodec.h"
+#include "trace.h"
+
+/* Appends an event to the log, growing its storage as needed. */
+static void append_event(event_log_t* log, const event_t* event)
+{
+    TRACE_BEGIN("log_event");
+    if (log->count == log->capacity)
+    {
+        log->capacity = log->capacity ? log->capacity * 2 : 64;
+        log->events = realloc(log->events, sizeof(event_t) * log->capacity);
+    }
+    log->events[log->count++] = *event;
+    TRACE_END("log_event");
+}
+
+void start_event_log(event_log_t* log, char** grid, int height, int width)
+{
+    log->initial = get_copy(grid, height, width);
+    log->height = height;
+    log->width = width;
+    log->events = NULL;
+    log->count = 0;
+    log->capacity = 0;
+}
+
+void log_move(event_log_t* log, pos_t from, pos_t to, char tank)
+{
+    event_t event;
+    event.type = EVENT_MOVE;
+    event.from = from;
+    event.to = to;
+    event.dir = tank;
+    event.outcome = SHOT_MISSED;
+    event.steps = 0;
+    append_event(log, &event);
+}
+
+void log_shot(event_log_t* log, pos_t origin, char dir, pos_t end, int steps,
+shot_outcome_t outcome)
+{
+    event_t event;
+    event.type = EVENT_SHOT;
+    event.from = origin;
+    event.to = end;
+    event.dir = dir;
+    event.outcome = outcome;
+    event.steps = steps;
+    append_event(log, &event);
+}
+
+bool repeats_last_frame(const event_log_t* log, unsigned long long hash,
+unsigned long long logged_hash)
+{
+    size_t k;
+
+    /* Shots which drew no laser added no frame; look past them. */
+    k = log->count;
+    while (k > 0 && log->events[k - 1].type == EVENT_SHOT && log->events[k - 1].steps == 0)
+    {
+        k--;
+    }
+    return k > 0 && log->events[k - 1].type == EVENT_MOVE && hash == logged_hash;
+}
+
+/* Replays a shot on grid, emitting a frame for each drawn laser step. */
+static void expand_shot(const event_t* event, char** grid, int height, int width,
+frame_callback_t callback, void* context)
+{
+    pos_t laser_pos;
+    char laser_dir;
+    int drawn;
+
+    laser_pos = event->from;
+    laser_dir = event->dir;
+    drawn = 0;
+
+    /* The recorded step count bounds the replay, so the opponent tank
+    needn't be known here. */
+    while (drawn < event->steps)
+    {
+        advance_laser(&laser_pos, laser_dir);
+        if (laser_pos.x < 0 || laser_pos.x >= height
+        || laser_pos.y < 0 || laser_pos.y >= width)
+        {
+            break;
+        }
+
+        if (is_mirror(grid[laser_pos.x][laser_pos.y]))
+        {
+            laser_dir = reflect_laser(laser_dir, grid[laser_pos.x][laser_pos.y]);
+        }
+        else
+        {
+            grid[laser_pos.x][laser_pos.y] = get_laser(laser_dir);
+            callback(grid, context);
+            grid[laser_pos.x][laser_pos.y] = ' ';
+            drawn++;
+        }
+    }
+}
+
+void expand_events(const event_log_t* log, frame_callback_t callback, void* context)
+{
+    char** grid;
+    size_t i;
+
+    /* Replay the events on a scratch copy of the initial map. */
+    grid = get_copy(log->initial, log->height, log->width);
+    for (i = 0; i < log->count; i++)
+    {
+        const event_t* event;
+        event = &log->events[i];
+        if (event->type == EVENT_MOVE)
+        {
+            grid[event->from.x][event->from.y] = ' ';
+            grid[event->to.x][event->to.y] = event->dir;
+            callback(grid, context);
+        }
+        else if (event->type == EVENT_SHOT)
+        {
+            expand_shot(event, grid, log->height, log->width, callback, context);
+        }
+    }
+    delete_map(grid, log->height);
+}
+
+/* State of the text log writer across frames. */
+typedef struct
+{
+    FILE* outfile;
+    int height;
+    int width;
+    bool first_map_written;
+} text_writer_t;
+
+/* Writes a frame in the text log format. */
+static void write_text_frame(char** grid, void* context)
+{
+    text_writer_t* writer;
+    writer = context;
+
+    /* Print a separator line in between each snapshot of map. */
+    if (writer->first_map_written)
+    {
+        write_separator(writer->width, writer->outfile);
+    }
+    write_map(grid, writer->height, writer->width, writer->outfile);
+    writer->first_map_written = true;
+}
+
+/* Writes a frame in the compressed log format. */
+static void write_compressed_frame(char** grid, void* context)
+{
+    logz_write_frame(context, grid);
+}
+
+void write_event_log(const event_log_t* log, const char* filename)
+{
+    text_writer_t writer;
+
+    /* Open file for writing. */
+    writer.outfile = fopen(filename, "w");
+    if (! writer.outfile)
+    {
+        fprintf(stderr, "Couldn't open %s for writing.\n", filename);
+        return;
+    }
+
+    TRACE_BEGIN("write_event_log");
+    writer.height = log->height;
+    writer.width = log->width;
+    writer.first_map_written = false;
+    expand_events(log, write_text_frame, &writer);
+
+    /* Close file. */
+    fclose(writer.outfile);
+    TRACE_END("write_event_log");
+}
+
+void write_event_log_compressed(const event_log_t* log, const char* filename)
+{
+    logz_writer_t writer;
+
+    /* Open file for writing. */
+    FILE* outfile;
+    outfile = fopen(filename, "wb");
+    if (! outfile)
+    {
+        fprintf(stderr, "Couldn't open %s for writing.\n", filename);
+        return;
+    }
+
+    if (!logz_open_writer(&writer, outfile, log->height, log->width))
+    {
+        fprintf(stderr, "Couldn't write %s.\n", filename);
+        fclose(outfile);
+        return;
+    }
+    TRACE_BEGIN("write_event_log");
+    expand_events(log, write_compressed_frame, &writer);
+
+    /* Close file. */
+    logz_close_writer(&writer);
+    fclose(outfile);
+    TRACE_END("write_event_log");
+}
+
+void free_event_log(event_log_t* log)
+{
+    if (log->initial)
+    {
+        delete_map(log->initial, log->height);
+    }
+    free(log->events);
+    log->initial = NULL;
+    log->events = NULL;
+    log->count = 0;
+    log->capacity = 0;
+}
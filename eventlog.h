@@ -0,0 +1,114 @@
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+#include <stdio.h>
+#include <stddef.h>
+#include "utils.h"
+
+/* Event-sourced game log.
+ *
+ * Instead of a full copy of the map per logged frame, the game log keeps
+ * a snapshot of the map when the game started plus one small record per
+ * semantic event. Frames are only materialized when the log is written,
+ * by replaying the events on a scratch copy of the initial map. */
+
+/** Defines the kinds of events recorded in the game log. */
+typedef enum
+{
+    EVENT_MOVE,     /* A tank went or faced somewhere (one frame). */
+    EVENT_SHOT      /* A tank fired its laser (one frame per laser step). */
+} event_type_t;
+
+/** Defines the ways a laser shot can end. */
+typedef enum
+{
+    SHOT_MISSED,    /* The laser left the map or was cut short. */
+    SHOT_HIT,       /* The laser hit the opponent tank. */
+    SHOT_SELF       /* The laser came back to the shooter, which stopped it. */
+} shot_outcome_t;
+
+/** Defines a single event of the game log. */
+typedef struct
+{
+    event_type_t type;
+    pos_t from;     /* Move: previous position. Shot: position of the shooter. */
+    pos_t to;       /* Move: new position. Shot: last cell the laser reached. */
+    char dir;       /* Move: tank character after the move. Shot: initial laser direction. */
+    shot_outcome_t outcome;  /* Shot only. */
+    int steps;      /* Shot only: number of laser steps drawn on the map. */
+} event_t;
+
+/** Defines an event log: the initial map plus the events applied to it. */
+typedef struct
+{
+    char** initial;
+    int height;
+    int width;
+    event_t* events;
+    size_t count;
+    size_t capacity;
+} event_log_t;
+
+/** Receives one expanded frame of an event log. Every frame has the
+ * height and width of the log.
+ * @param grid pointer to the 2D array of characters representing the frame.
+ * @param context pointer passed through from expand_events. */
+typedef void (*frame_callback_t)(char** grid, void* context);
+
+/** Starts an empty event log from the current state of a map.
+ * @param log event log to start.
+ * @param grid pointer to the 2D array of characters representing the map.
+ * @param height number of rows in the grid.
+ * @param width number of columns in the grid. */
+void start_event_log(event_log_t* log, char** grid, int height, int width);
+
+/** Records that a tank went or faced somewhere.
+ * @param log event log where the event is recorded.
+ * @param from position of the tank before the move.
+ * @param to position of the tank after the move.
+ * @param tank character representation of the tank after the move. */
+void log_move(event_log_t* log, pos_t from, pos_t to, char tank);
+
+/** Records a laser shot.
+ * @param log event log where the event is recorded.
+ * @param origin position of the shooting tank.
+ * @param dir initial direction of the laser.
+ * @param end last cell the laser reached (outside the map on a miss).
+ * @param steps number of laser steps drawn on the map.
+ * @param outcome whether the laser hit the opponent tank. */
+void log_shot(event_log_t* log, pos_t origin, char dir, pos_t end, int steps,
+shot_outcome_t outcome);
+
+/** Returns true if a move leaving the grid with a given hash would only
+ * repeat the last frame of the log: the last event with a frame is a move
+ * and the grid hash is the one it was logged with. The initial map is not
+ * a frame of the log, so the first move never repeats anything.
+ * @param log event log the move would be recorded in.
+ * @param hash hash of the grid after the move (see zobrist.h).
+ * @param logged_hash hash of the grid when the last move was recorded. */
+bool repeats_last_frame(const event_log_t* log, unsigned long long hash,
+unsigned long long logged_hash);
+
+/** Replays an event log and passes every frame it expands to, in order,
+ * to a callback. The frames are exactly those the game used to log.
+ * @param log event log to expand.
+ * @param callback function receiving each frame.
+ * @param context pointer passed through to the callback. */
+void expand_events(const event_log_t* log, frame_callback_t callback, void* context);
+
+/** Writes the expanded frames of an event log to a given file in the
+ * text log format.
+ * @param log event log to write.
+ * @param filename filename of the file where the log is to be written. */
+void write_event_log(const event_log_t* log, const char* filename);
+
+/** Writes the expanded frames of an event log to a given file in the
+ * compressed log format (see logcodec.h).
+ * @param log event log to write.
+ * @param filename filename of the file where the log is to be written. */
+void write_event_log_compressed(const event_log_t* log, const char* filename);
+
+/** Frees heap memory associated with an event log.
+ * @param log event log to free. */
+void free_event_log(event_log_t* log);
+
+#endif  /* EVENTLOG_H */
@@ -0,0 +1,294 @@
+#include "game.h"
+#include <stdlib.h>
+#include "beam.h"
+#include "broadcast.h"
+#include "sleep.h"
+#include "trace.h"
+#include "viewport.h"
+#include "zobrist.h"
+
+char menu()
+{
+    char choice;
+    do {
+        fprintf(stdout, "w to go/face up\n");
+        fprintf(stdout, "s to go/face down\n");
+        fprintf(stdout, "a to go/face left\n");
+        fprintf(stdout, "d to go/face right\n");
+        fprintf(stdout, "f to shoot laser\n");
+        fprintf(stdout, "l to save the log\n");
+        fprintf(stdout, "action: ");
+        fscanf(stdin, " %c", &choice);
+    } while (choice != 'w' && choice != 's' && choice != 'a' && choice != 'd'
+    && choice != 'f' && choice != 'l');
+    return choice;
+}
+
+long beam_max_msec = 2000;
+long beam_fps = 30;
+
+/* Draws the cells a laser crosses, coalescing them into frames. The trail
+stays on the map until the last frame, then the cells are restored. */
+static void animate_beam(beam_cell_t* trail, int steps, char** grid, int height, int width)
+{
+    /* Number and length of frames. */
+    int frames;
+    long frame_msec;
+
+    /* First and last (excluded) cells of the current frame. */
+    int first, last;
+
+    long long start, remaining;
+    int frame, k;
+
+    frames = steps;
+    frame_msec = SLEEP_DURATION;
+    if ((long) steps * SLEEP_DURATION > beam_max_msec)
+    {
+        double most;
+
+        /* Counted in double, as both settings may be large. */
+        most = (double) beam_max_msec * beam_fps / 1000;
+        frames = most < steps ? (int) most : steps;
+        frames = frames > 0 ? frames : 1;
+        frame_msec = beam_max_msec / frames;
+    }
+
+    start = usec_now();
+    first = 0;
+    for (frame = 0; frame < frames; frame++)
+    {
+        TRACE_BEGIN("beam_frame");
+        last = (int) ((long long) steps * (frame + 1) / frames);
+
+        /* Draw the part of the trail the laser covers in this frame. */
+        for (k = first; k < last; k++)
+        {
+            trail[k].under = grid[trail[k].pos.x][trail[k].pos.y];
+            set_cell(grid, trail[k].pos.x, trail[k].pos.y, trail[k].laser);
+        }
+        system("clear");
+        draw_view(grid, height, width, trail[last - 1].pos, player_pos, enemy_pos,
+        stdout);
+        if (frame_broadcast)
+        {
+            publish_frame(frame_broadcast, grid, trail[last - 1].pos, player_pos, enemy_pos);
+        }
+        TRACE_END("beam_frame");
+
+        /* Frames keep to a schedule, so drawing time doesn't add up. */
+        remaining = start + (frame + 1) * frame_msec * 1000LL - usec_now();
+        if (remaining > 0)
+        {
+            msleep((long) (remaining / 1000));
+        }
+        first = last;
+    }
+
+    /* Undo in reverse, for cells the laser crosses twice. */
+    for (k = steps - 1; k >= 0; k--)
+    {
+        set_cell(grid, trail[k].pos.x, trail[k].pos.y, trail[k].under);
+    }
+}
+
+/* Fires the laser of the tank at shooter_pos towards target_pos, animates
+it and records the shot in the game log. Returns true if the target is hit. */
+static bool fire(pos_t shooter_pos, pos_t target_pos, char** grid, int height, int width)
+{
+    /* Kept from shot to shot, so its buffers are reused. */
+    static beam_tracer_t tracer;
+
+    char initial_dir;
+    beam_end_t end;
+    shot_outcome_t outcome;
+
+    /* Find the cells to draw before drawing any. */
+    initial_dir = get_player_dir(grid[shooter_pos.x][shooter_pos.y]);
+    end = trace_beam(&tracer, grid, height, width, shooter_pos, initial_dir, target_pos);
+    outcome = end == BEAM_TARGET ? SHOT_HIT : (end == BEAM_SELF ? SHOT_SELF : SHOT_MISSED);
+
+    /* The log keeps every step, however the laser is drawn. */
+    log_shot(&game_log, shooter_pos, initial_dir, tracer.end, tracer.steps, outcome);
+    animate_beam(tracer.trail, tracer.steps, grid, height, width);
+    return outcome == SHOT_HIT;
+}
+
+void enemy_fire(bool* exit_flag, char** grid, int height, int width)
+{
+    /* If laser hits the player tank, declare lose and exit. */
+    if (fire(enemy_pos, player_pos, grid, height, width))
+    {
+        fprintf(stdout, "You lose!\n");
+        *exit_flag = true;
+    }
+}
+
+void player_fire(bool* exit_flag, char** grid, int height, int width)
+{
+    /* If laser hits the enemy tank, declare win and exit. */
+    if (fire(player_pos, enemy_pos, grid, height, width))
+    {
+        fprintf(stdout, "You win!\n");
+        *exit_flag = true;
+    }
+}
+
+bool in_line_of_sight(pos_t player_pos, pos_t enemy_pos, char** grid)
+{
+    if (player_pos.x == enemy_pos.x)
+    {
+        /* Player is in the horizontal line of sight of the enemy tank. */
+        char enemy_dir;
+        enemy_dir = get_player_dir(grid[enemy_pos.x][enemy_pos.y]);
+        if ((enemy_dir == 'r' && enemy_pos.y < player_pos.y) ||
+        (enemy_dir == 'l' && player_pos.y < enemy_pos.y))
+        {
+            /* Enemy fires. */
+            return true;
+        }
+    }
+    else if (player_pos.y == enemy_pos.y)
+    {
+        /* Player is in the vertical line of sight of the enemy tank. */
+        char enemy_dir;
+        enemy_dir = get_player_dir(grid[enemy_pos.x][enemy_pos.y]);
+        if ((enemy_dir == 'u' && player_pos.x < enemy_pos.x) ||
+        (enemy_dir == 'd' && enemy_pos.x < player_pos.x))
+        {
+            /* Enemy fires. */
+            return true;
+        }
+    }
+    return false;
+}
+
+void go_or_face_upward(char** grid)
+{
+    /* If the player is not already facing upward. */
+    if (get_player_dir(grid[player_pos.x][player_pos.y]) != 'u')
+    {
+        /* Face upward. */
+        set_cell(grid, player_pos.x, player_pos.y, get_player('u'));
+    }
+    /* Attemp to move one step upward. */
+    else
+    {
+        /* The player cannot go to the same position as that of the mirror. */
+        /* The player cannot go out of the boundary of the map. */
+        if (player_pos.x - 1 >= 0 && 
+        !is_mirror(grid[player_pos.x - 1][player_pos.y]) &&
+        !is_player(grid[player_pos.x - 1][player_pos.y]))
+        {
+            /* Move the player one step upward. */
+            set_cell(grid, player_pos.x - 1, player_pos.y, grid[player_pos.x][player_pos.y]);
+            set_cell(grid, player_pos.x, player_pos.y, ' ');
+            player_pos.x--;
+        }
+    }
+}
+
+void go_or_face_downward(char** grid, int height)
+{
+    /* If the player is not already facing downward. */
+    if (get_player_dir(grid[player_pos.x][player_pos.y]) != 'd')
+    {
+        /* Face downward. */
+        set_cell(grid, player_pos.x, player_pos.y, get_player('d'));
+    }
+    /* Attemp to move one step downward. */
+    else
+    {
+        /* The player cannot go to the same position as that of the mirror. */
+        /* The player cannot go out of the boundary of the map. */
+        if (player_pos.x + 1 < height &&
+        !is_mirror(grid[player_pos.x + 1][player_pos.y]) &&
+        !is_player(grid[player_pos.x + 1][player_pos.y]))
+        {
+            /* Move the player one step downward. */
+            set_cell(grid, player_pos.x + 1, player_pos.y, grid[player_pos.x][player_pos.y]);
+            set_cell(grid, player_pos.x, player_pos.y, ' ');
+            player_pos.x++;
+        }
+    }
+}
+
+void go_or_face_rightward(char** grid, int width)
+{
+    /* If the player is not already facing rightward. */
+    if (get_player_dir(grid[player_pos.x][player_pos.y]) != 'r')
+    {
+        /* Face rightward. */
+        set_cell(grid, player_pos.x, player_pos.y, get_player('r'));
+    }
+    /* Attemp to move one step rightward. */
+    else
+    {
+        /* The player cannot go to the same position as that of the mirror. */
+        /* The player cannot go out of the boundary of the map. */
+        if (player_pos.y + 1 < width &&
+        !is_mirror(grid[player_pos.x][player_pos.y + 1]) &&
+        !is_player(grid[player_pos.x][player_pos.y + 1]))
+        {
+            /* Move the player one step rightward. */
+            set_cell(grid, player_pos.x, player_pos.y + 1, grid[player_pos.x][player_pos.y]);
+            set_cell(grid, player_pos.x, player_pos.y, ' ');
+            player_pos.y++;
+        }
+    }
+}
+
+void go_or_face_leftward(char** grid)
+{
+    /* If the player is not already facing leftward. */
+    if (get_player_dir(grid[player_pos.x][player_pos.y]) != 'l')
+    {
+        /* Face leftward. */
+        set_cell(grid, player_pos.x, player_pos.y, get_player('l'));
+    }
+    /* Attemp to move one step leftward. */
+    else
+    {
+        /* The player cannot go to the same position as that of the mirror. */
+        /* The player cannot go out of the boundary of the map. */
+        if (player_pos.y - 1 >= 0 &&
+        !is_mirror(grid[player_pos.x][player_pos.y - 1]) && 
+        !is_player(grid[player_pos.x][player_pos.y - 1]))
+        {
+            /* Move the player one step leftward. */
+            set_cell(grid, player_pos.x, player_pos.y - 1, grid[player_pos.x][player_pos.y]);
+            set_cell(grid, player_pos.x, player_pos.y, ' ');
+            player_pos.y--;
+        }
+    }
+}
+
+void go_or_face(char** grid, int height, int width, pos_t* tank, char dir)
+{
+    /* Position one step in the given direction. */
+    pos_t next;
+
+    /* If the tank is not already facing the direction. */
+    if (get_player_dir(grid[tank->x][tank->y]) != dir)
+    {
+        /* Face the direction. */
+        set_cell(grid, tank->x, tank->y, get_player(dir));
+        return;
+    }
+
+    /* Attempt to move one step in the direction. */
+    next = *tank;
+    advance_laser(&next, dir);
+
+    /* The tank cannot go to the same position as that of the mirror. */
+    /* The tank cannot go out of the boundary of the map. */
+    if (next.x >= 0 && next.x < height && next.y >= 0 && next.y < width &&
+    !is_mirror(grid[next.x][next.y]) &&
+    !is_player(grid[next.x][next.y]))
+    {
+        /* Move the tank one step. */
+        set_cell(grid, next.x, next.y, grid[tank->x][tank->y]);
+        set_cell(grid, tank->x, tank->y, ' ');
+        *tank = next;
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef GAME_H
+#define GAME_H
+#include <stdbool.h>
+#include "eventlog.h"
+#include "utils.h"
+
+/* State of the game being played, defined by the program which plays it. */
+
+/** Positions of the player and enemy tanks. */
+extern pos_t player_pos, enemy_pos;
+
+/** Log of the game, to which every shot is added. */
+extern event_log_t game_log;
+
+/** Milliseconds a laser beam takes to advance one cell on screen. */
+extern const unsigned SLEEP_DURATION;
+
+/** Longest time a shot takes on screen, in milliseconds. A laser which
+ * would take longer at one cell per SLEEP_DURATION is drawn several cells
+ * per frame instead. 0 draws such a laser in a single frame. */
+extern long beam_max_msec;
+
+/** Most frames per second used to draw a laser cut down to beam_max_msec.
+ * At least 1. */
+extern long beam_fps;
+
+/** This function is called when the player is in the line of sight
+ * of the enemy tank. 
+ * @param exit_flag exit flag of the program.
+ * @param grid pointer to the 2D array of character representing map.
+ * @param height number of rows in the grid.
+ * @param width number of columns in the grid. /*/
+void enemy_fire(bool* exit_flag, char** grid, int height, int width);
+
+/** This function is called when the player is in the line of sight
+ * of the enemy tank. 
+ * @param exit_flag exit flag of the program.
+ * @param grid pointer to the 2D array of character representing map.
+ * @param height number of rows in the grid.
+ * @param width number of columns in the grid. /*/
+void player_fire(bool* exit_flag, char** grid, int height, int width);
+
+/** Returns true if the player is in the line of sight of the enemy tank.
+ * return false otherwise. 
+ * @param player_pos position of the player tank.
+ * @param enemy_pos position of the enemy tank.
+ * @param grid pointer to the 2D array of characters representing the map.
+ * @return true if player is in line of sight of the enemy tank,
+ * returns false otherwise.*/
+bool in_line_of_sight(pos_t player_pos, pos_t enemy_pos, char** grid);
+
+/** Attemps to make the player face to go one step upward. 
+ * @param grid pointer to the 2D array of characters representing the map. */
+void go_or_face_upward(char** grid);
+
+/** Attemps to make the player face to go one step upward. 
+ * @param grid pointer to the 2D array of characters representing map.
+ * @param height number of rows in the grid. */
+void go_or_face_downward(char** grid, int height);
+
+/** Attemps to make the player face to go one step rightward.
+ * @param grid pointer to the 2D array of characters representing the map. 
+ * @param width number of columns in the grid. */
+void go_or_face_rightward(char** grid, int width);
+
+/** Attemps to make the player face to go one step leftward. 
+ * @param grid pointer to the 2D array of characters representing the map. */
+void go_or_face_leftward(char** grid);
+
+/** Attempts to make a tank face a direction, or go one step in that
+ * direction if it already faces it.
+ * @param grid pointer to the 2D array of characters representing the map.
+ * @param height number of rows in the grid.
+ * @param width number of columns in the grid.
+ * @param tank position of the tank, updated in place.
+ * @param dir direction to go or face (u/d/l/r). */
+void go_or_face(char** grid, int height, int width, pos_t* tank, char dir);
+
+/** Gets a valid menu choice from the user. 
+ * @return character representation of the menu choice.
+ * 
+ * w: to move upward.
+ * a: to move leftward.
+ * s: to move downward.
+ * d: to move rightward.
+ * f: to fire.
+ * l: to save game log. */
+char menu();
+
+#endif  /* GAME_H */
@@ -0,0 +1,149 @@
+#include "killmap.h"
+#include "beam.h"
+#include <stdlib.h>
+#include <string.h>
+
+const kill_map_t* kill_overlay = NULL;
+
+/* Returns the KILL_* bit of a facing. */
+static unsigned char facing_bit(char dir)
+{
+    switch (dir)
+    {
+        case 'u': return KILL_UP;
+        case 'd': return KILL_DOWN;
+        case 'l': return KILL_LEFT;
+        case 'r': return KILL_RIGHT;
+        default: return 0;
+    }
+}
+
+/* Returns the opposite of a direction. */
+static char opposite(char dir)
+{
+    switch (dir)
+    {
+        case 'u': return 'd';
+        case 'd': return 'u';
+        case 'l': return 'r';
+        default: return 'l';
+    }
+}
+
+void create_kill_map(kill_map_t* kill_map, int height, int width)
+{
+    size_t cells;
+
+    cells = (size_t) height * width;
+    kill_map->height = height;
+    kill_map->width = width;
+    kill_map->facings = calloc(cells > 0 ? cells : 1, 1);
+    kill_map->touched = malloc(sizeof(size_t) * (cells > 0 ? cells : 1));
+    kill_map->touched_count = 0;
+    kill_map->walked = calloc(cells > 0 ? cells : 1, sizeof(unsigned));
+    kill_map->walk = 0;
+    kill_map->target.x = -1;
+    kill_map->target.y = -1;
+}
+
+void free_kill_map(kill_map_t* kill_map)
+{
+    free(kill_map->facings);
+    free(kill_map->touched);
+    free(kill_map->walked);
+    kill_map->facings = NULL;
+    kill_map->touched = NULL;
+    kill_map->walked = NULL;
+}
+
+void compute_kill_map(kill_map_t* kill_map, char** grid, pos_t target)
+{
+    static const char DIRS[] = {'u', 'd', 'l', 'r'};
+    size_t k;
+    int d;
+
+    /* Clear what the previous target left behind. */
+    for (k = 0; k < kill_map->touched_count; k++)
+    {
+        kill_map->facings[kill_map->touched[k]] = 0;
+    }
+    kill_map->touched_count = 0;
+    kill_map->target = target;
+
+    /* Walk backward from the target in each direction. */
+    for (d = 0; d < 4; d++)
+    {
+        pos_t laser_pos;
+        char laser_dir;
+        long taken;
+
+        laser_pos = target;
+        laser_dir = DIRS[d];
+        if (++kill_map->walk == 0)
+        {
+            /* The counter wrapped around; forget all walks. */
+            memset(kill_map->walked, 0, sizeof(unsigned) * kill_map->height * kill_map->width);
+            kill_map->walk = 1;
+        }
+        for (taken = 1; beam_step_budget <= 0 || taken <= beam_step_budget; taken++)
+        {
+            size_t cell;
+
+            /* A laser fired from where the walk is after taken steps
+            reaches the target in as many steps. */
+            advance_laser(&laser_pos, laser_dir);
+            if (laser_pos.x < 0 || laser_pos.x >= kill_map->height
+            || laser_pos.y < 0 || laser_pos.y >= kill_map->width)
+            {
+                break;
+            }
+
+            /* Mirrors turn the walk just like they turn a laser. */
+            if (is_mirror(grid[laser_pos.x][laser_pos.y]))
+            {
+                laser_dir = reflect_laser(laser_dir, grid[laser_pos.x][laser_pos.y]);
+                continue;
+            }
+
+            /* Back where it started: the laser goes around in a loop. */
+            if (laser_pos.x == target.x && laser_pos.y == target.y)
+            {
+                if (laser_dir == DIRS[d])
+                {
+                    break;
+                }
+                continue;
+            }
+
+            /* A tank here facing back along the walk hits the target,
+            unless the laser crosses the cell again on the way. */
+            cell = (size_t) laser_pos.x * kill_map->width + laser_pos.y;
+            if (kill_map->walked[cell] == kill_map->walk)
+            {
+                continue;
+            }
+            kill_map->walked[cell] = kill_map->walk;
+            if (!kill_map->facings[cell])
+            {
+                kill_map->touched[kill_map->touched_count++] = cell;
+            }
+            kill_map->facings[cell] |= facing_bit(opposite(laser_dir));
+        }
+    }
+}
+
+bool kill_map_hits(const kill_map_t* kill_map, int x, int y, char dir)
+{
+    return (kill_map->facings[(size_t) x * kill_map->width + y] & facing_bit(dir)) != 0;
+}
+
+bool kill_map_marks(const kill_map_t* kill_map, int x, int y)
+{
+    return kill_map->facings[(size_t) x * kill_map->width + y] != 0;
+}
+
+bool kill_overlay_marks(int height, int width, int x, int y)
+{
+    return kill_overlay && kill_overlay->height == height && kill_overlay->width == width
+    && kill_map_marks(kill_overlay, x, y);
+}
@@ -0,0 +1,68 @@
+#ifndef KILLMAP_H
+#define KILLMAP_H
+#include <stdbool.h>
+#include <stddef.h>
+#include "utils.h"
+
+/* Kill map: every (cell, facing) from which a shot hits a target.
+ *
+ * Lasers retrace their way back through mirrors, so instead of firing from
+ * every cell the kill map follows a laser backward from the target in all
+ * four directions; every free cell it crosses is a firing position, facing
+ * against the direction of the backward walk, unless the walk crossed the
+ * cell before: a tank there would stop its own laser on the way. Walks
+ * stop after beam_step_budget steps, if set, as lasers do. The cost is the
+ * number of cells reached, not the size of the map. */
+
+/** Defines a kill map. */
+typedef struct
+{
+    int height;
+    int width;
+    unsigned char* facings;     /* Per cell, a KILL_* bit per winning facing. */
+    size_t* touched;            /* Cells with facings set, to clear them fast. */
+    size_t touched_count;
+    unsigned* walked;           /* Per cell, the last walk which crossed it. */
+    unsigned walk;              /* Number of the current walk. */
+    pos_t target;
+} kill_map_t;
+
+/* Bits of kill_map_t::facings. */
+#define KILL_UP 1U
+#define KILL_DOWN 2U
+#define KILL_LEFT 4U
+#define KILL_RIGHT 8U
+
+/** Kill map drawn over terminal output by write_map and draw_view, or NULL
+ * for none. Logs written to files never show it. */
+extern const kill_map_t* kill_overlay;
+
+/** Allocates an empty kill map for maps of a given size.
+ * @param kill_map kill map to allocate.
+ * @param height number of rows in the map.
+ * @param width number of columns in the map. */
+void create_kill_map(kill_map_t* kill_map, int height, int width);
+
+/** Frees heap memory associated with a kill map.
+ * @param kill_map kill map allocated by create_kill_map. */
+void free_kill_map(kill_map_t* kill_map);
+
+/** Computes the kill map of a target, forgetting the previous one.
+ * @param kill_map kill map allocated for the size of grid.
+ * @param grid pointer to the 2D array of characters representing the map.
+ * @param target position of the target tank. */
+void compute_kill_map(kill_map_t* kill_map, char** grid, pos_t target);
+
+/** Returns true if a tank at (x, y) facing dir (u/d/l/r) hits the target
+ * of the kill map when it fires. */
+bool kill_map_hits(const kill_map_t* kill_map, int x, int y, char dir);
+
+/** Returns true if a tank at (x, y) hits the target of the kill map when
+ * it fires facing some direction. */
+bool kill_map_marks(const kill_map_t* kill_map, int x, int y);
+
+/** Returns true if kill_overlay is set for a map of the given size and
+ * marks (x, y) as a firing position. */
+bool kill_overlay_marks(int height, int width, int x, int y);
+
+#endif  /* KILLMAP_H */
@@ -2,6 +2,7 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include "trace.h"
 
 /** External functions called by linked list api. */
 extern void delete_map(char** grid, int height);
@@ -14,6 +15,8 @@ void insert_last(node_t** list, char** grid, int height, int width)
     node_t* new_node;
     node_t* last;
 
+    TRACE_BEGIN("insert_last");
+
     /* Copy map. */
     new_grid = get_copy(grid, height, width);
     
@@ -30,6 +33,7 @@ void insert_last(node_t** list, char** grid, int height, int width)
     if (*list == NULL)
     {
         *list = new_node;
+        TRACE_END("insert_last");
         return;
     }
 
@@ -38,6 +42,7 @@ void insert_last(node_t** list, char** grid, int height, int width)
         last = last->next;
     }
     last->next = new_node;
+    TRACE_END("insert_last");
     return;
 }
 
@@ -57,19 +62,14 @@ void write_list(const node_t* list, const char* filename)
     }
 
     /* Traverse the linked list. */
+    TRACE_BEGIN("write_list");
     first_map_written = false;
     for (current = list; current != NULL; current = current->next)
     {
         /* Print a separator line in between each snapshot of map. */
         if (first_map_written)
         {
-            int i;
-            fprintf(outfile,"\n");
-            for (i = 0; i < current->width + 2; i++)
-            {
-                fprintf(outfile, "-");
-            }
-            fprintf(outfile, "\n\n");
+            write_separator(current->width, outfile);
         }
 
         /* Write the map to file pointed to by outfile pointer. */
@@ -79,6 +79,18 @@ void write_list(const node_t* list, const char* filename)
 
     /* Close file. */
     fclose(outfile);
+    TRACE_END("write_list");
+}
+
+void write_separator(int width, FILE* stream)
+{
+    int i;
+    fprintf(stream,"\n");
+    for (i = 0; i < width + 2; i++)
+    {
+        fprintf(stream, "-");
+    }
+    fprintf(stream, "\n\n");
 }
 
 void free_list(node_t* list)
@@ -28,6 +28,12 @@ void insert_last(node_t** list, char** grid, int height, int width);
  * to be written. */
 void write_list(const node_t* list, const char* filename);
 
+/** Writes the separator line which the text log puts in between
+ * two snapshots of a map.
+ * @param width number of columns in the map.
+ * @param stream file stream where the separator is to be written. */
+void write_separator(int width, FILE* stream);
+
 /** Frees heap memory associated with list. 
  * @param list pointer to the head of the singly linked list. */
 void free_list(node_t* list);
@@ -0,0 +1,223 @@
+#include "logcodec.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Magic bytes at the start of every compressed log. */
+static const char LOGZ_MAGIC[4] = {'L', 'T', 'Z', '1'};
+
+/* Tags written in front of every frame and at the end of the log. */
+#define LOGZ_FRAME_TAG 'F'
+#define LOGZ_END_TAG 'E'
+
+/* Writes an unsigned integer in LEB128 (7 bits per byte) encoding. */
+static void write_varint(FILE* stream, unsigned long value)
+{
+    while (value >= 0x80)
+    {
+        fputc((int) ((value & 0x7F) | 0x80), stream);
+        value >>= 7;
+    }
+    fputc((int) value, stream);
+}
+
+/* Reads an unsigned integer in LEB128 encoding. Returns false on
+end of file or on an overlong encoding. */
+static bool read_varint(FILE* stream, unsigned long* value)
+{
+    int c;
+    unsigned shift;
+
+    *value = 0;
+    for (shift = 0; shift < sizeof(unsigned long) * 8; shift += 7)
+    {
+        c = fgetc(stream);
+        if (c == EOF)
+        {
+            return false;
+        }
+        *value |= (unsigned long) (c & 0x7F) << shift;
+        if (!(c & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool logz_open_writer(logz_writer_t* writer, FILE* stream, int height, int width)
+{
+    size_t cells;
+
+    cells = (size_t) height * (size_t) width;
+    writer->stream = stream;
+    writer->height = height;
+    writer->width = width;
+
+    /* The first frame is encoded against an empty map. */
+    writer->prev = malloc(cells > 0 ? cells : 1);
+    if (!writer->prev)
+    {
+        return false;
+    }
+    memset(writer->prev, ' ', cells);
+
+    /* Write header. */
+    fwrite(LOGZ_MAGIC, 1, sizeof(LOGZ_MAGIC), stream);
+    write_varint(stream, (unsigned long) height);
+    write_varint(stream, (unsigned long) width);
+    return !ferror(stream);
+}
+
+void logz_write_frame(logz_writer_t* writer, char** grid)
+{
+    /* Length of the current run of unchanged cells. */
+    unsigned long zeros;
+
+    /* Literal (changed) cells are buffered to know their count upfront. */
+    char literals[256];
+    unsigned long literal_count;
+
+    int i, j;
+
+    fputc(LOGZ_FRAME_TAG, writer->stream);
+
+    zeros = 0;
+    literal_count = 0;
+    for (i = 0; i < writer->height; i++)
+    {
+        char* prev_row;
+        prev_row = writer->prev + (size_t) i * writer->width;
+        for (j = 0; j < writer->width; j++)
+        {
+            char delta;
+            delta = (char) (grid[i][j] ^ prev_row[j]);
+            prev_row[j] = grid[i][j];
+
+            if (delta == 0 && literal_count == 0)
+            {
+                /* Extend the run of unchanged cells. */
+                zeros++;
+                continue;
+            }
+            if (delta == 0 || literal_count == sizeof(literals))
+            {
+                /* Flush the token and start a new one. */
+                write_varint(writer->stream, zeros);
+                write_varint(writer->stream, literal_count);
+                fwrite(literals, 1, literal_count, writer->stream);
+                zeros = 0;
+                literal_count = 0;
+                if (delta == 0)
+                {
+                    zeros++;
+                    continue;
+                }
+            }
+            literals[literal_count++] = delta;
+        }
+    }
+
+    /* Flush the trailing token, if any. */
+    if (zeros > 0 || literal_count > 0)
+    {
+        write_varint(writer->stream, zeros);
+        write_varint(writer->stream, literal_count);
+        fwrite(literals, 1, literal_count, writer->stream);
+    }
+}
+
+void logz_close_writer(logz_writer_t* writer)
+{
+    fputc(LOGZ_END_TAG, writer->stream);
+    free(writer->prev);
+    writer->prev = NULL;
+}
+
+bool logz_open_reader(logz_reader_t* reader, FILE* stream)
+{
+    char magic[sizeof(LOGZ_MAGIC)];
+    unsigned long height, width;
+
+    reader->stream = stream;
+    reader->prev = NULL;
+
+    /* Validate header. */
+    if (fread(magic, 1, sizeof(magic), stream) != sizeof(magic)
+    || memcmp(magic, LOGZ_MAGIC, sizeof(magic)) != 0)
+    {
+        return false;
+    }
+    if (!read_varint(stream, &height) || !read_varint(stream, &width)
+    || height > 0x7FFFFFFF || width > 0x7FFFFFFF)
+    {
+        return false;
+    }
+    reader->height = (int) height;
+    reader->width = (int) width;
+
+    reader->prev = malloc(height * width > 0 ? height * width : 1);
+    if (!reader->prev)
+    {
+        return false;
+    }
+    memset(reader->prev, ' ', height * width);
+    return true;
+}
+
+logz_status_t logz_read_frame(logz_reader_t* reader, char** grid)
+{
+    /* Number of cells decoded so far and in total. */
+    size_t decoded, cells;
+    int i, tag;
+
+    /* A log without its end tag was cut short. */
+    tag = fgetc(reader->stream);
+    if (tag == LOGZ_END_TAG)
+    {
+        return LOGZ_END;
+    }
+    if (tag != LOGZ_FRAME_TAG)
+    {
+        return LOGZ_ERROR;
+    }
+
+    /* Apply the tokens to the previous frame. */
+    cells = (size_t) reader->height * (size_t) reader->width;
+    decoded = 0;
+    while (decoded < cells)
+    {
+        unsigned long zeros, literal_count, k;
+        if (!read_varint(reader->stream, &zeros)
+        || !read_varint(reader->stream, &literal_count)
+        || zeros > cells - decoded
+        || literal_count > cells - decoded - zeros
+        || (zeros == 0 && literal_count == 0))
+        {
+            return LOGZ_ERROR;
+        }
+        decoded += zeros;
+        for (k = 0; k < literal_count; k++)
+        {
+            int c;
+            c = fgetc(reader->stream);
+            if (c == EOF)
+            {
+                return LOGZ_ERROR;
+            }
+            reader->prev[decoded++] ^= (char) c;
+        }
+    }
+
+    /* Copy the frame out. */
+    for (i = 0; i < reader->height; i++)
+    {
+        memcpy(grid[i], reader->prev + (size_t) i * reader->width, reader->width);
+    }
+    return LOGZ_FRAME;
+}
+
+void logz_close_reader(logz_reader_t* reader)
+{
+    free(reader->prev);
+    reader->prev = NULL;
+}
@@ -0,0 +1,80 @@
+#ifndef LOGCODEC_H
+#define LOGCODEC_H
+#include <stdio.h>
+#include <stdbool.h>
+
+/* Compressed game log format.
+ *
+ * A compressed log starts with the magic "LTZ1" followed by the height
+ * and width of the map. Every frame is XOR-ed against the previous one
+ * (the first one against an empty map) and the result is stored as a
+ * sequence of (zero run, literal count, literal bytes) tokens. Since
+ * consecutive frames usually differ by one or two cells, a frame costs a
+ * handful of bytes instead of a full copy of the map. */
+
+/** Extension of log filenames which are written in the compressed format. */
+#define LOGZ_EXTENSION ".ltz"
+
+/** Defines the state of a streaming compressed log writer. */
+typedef struct
+{
+    FILE* stream;
+    int height;
+    int width;
+    char* prev;     /* Previously written frame, height * width cells. */
+} logz_writer_t;
+
+/** Defines what logz_read_frame found. */
+typedef enum
+{
+    LOGZ_FRAME,     /* A frame was read. */
+    LOGZ_END,       /* The log ended where the writer ended it. */
+    LOGZ_ERROR      /* The log is truncated or malformed. */
+} logz_status_t;
+
+/** Defines the state of a streaming compressed log reader. */
+typedef struct
+{
+    FILE* stream;
+    int height;
+    int width;
+    char* prev;     /* Previously read frame, height * width cells. */
+} logz_reader_t;
+
+/** Writes the header of a compressed log and prepares the writer.
+ * @param writer writer to prepare.
+ * @param stream file stream where the compressed log is written.
+ * @param height number of rows in every frame.
+ * @param width number of columns in every frame.
+ * @return true on success, false otherwise. */
+bool logz_open_writer(logz_writer_t* writer, FILE* stream, int height, int width);
+
+/** Appends a frame to a compressed log.
+ * @param writer writer prepared by logz_open_writer.
+ * @param grid pointer to the 2D array of characters representing the map. */
+void logz_write_frame(logz_writer_t* writer, char** grid);
+
+/** Terminates the compressed log and frees memory held by the writer.
+ * The stream itself is not closed.
+ * @param writer writer prepared by logz_open_writer. */
+void logz_close_writer(logz_writer_t* writer);
+
+/** Reads the header of a compressed log and prepares the reader.
+ * @param reader reader to prepare.
+ * @param stream file stream from where the compressed log is read.
+ * @return true if the stream holds a valid header, false otherwise. */
+bool logz_open_reader(logz_reader_t* reader, FILE* stream);
+
+/** Reads the next frame of a compressed log.
+ * @param reader reader prepared by logz_open_reader.
+ * @param grid pointer to a 2D array of reader->height rows and
+ * reader->width columns which receives the frame.
+ * @return LOGZ_FRAME if a frame was read, LOGZ_END at the end tag of the
+ * log, LOGZ_ERROR if the log is truncated or malformed. */
+logz_status_t logz_read_frame(logz_reader_t* reader, char** grid);
+
+/** Frees memory held by the reader. The stream itself is not closed.
+ * @param reader reader prepared by logz_open_reader. */
+void logz_close_reader(logz_reader_t* reader);
+
+#endif  /* LOGCODEC_H */
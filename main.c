@@ -1,17 +1,119 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include "linkedlist.h"
+#include <string.h>
+#include "ai.h"
+#include "beam.h"
+#include "broadcast.h"
+#include "editor.h"
+#include "eventlog.h"
+#include "game.h"
+#include "killmap.h"
+#include "logcodec.h"
+#include "mapcache.h"
+#include "mapcheck.h"
+#include "sleep.h"
+#include "state.h"
+#include "trace.h"
 #include "utils.h"
+#include "viewport.h"
+#include "zobrist.h"
 
 /* Variable to keep track of player and enemy tanks. */
 pos_t player_pos, enemy_pos;
 
-/* An empty game log. */
-node_t* game_log = NULL;
+/* The game log, started once the map is read. */
+event_log_t game_log;
+
+/* Flag to indicate whether moves leaving the grid as in the last logged
+frame are left out of the log, and the hash of the grid in that frame. */
+static bool skip_repeats = false;
+static unsigned long long logged_hash;
 
 /* Modify this variable to adjust a preferable laser speed. */
 const unsigned SLEEP_DURATION = 250U; /* In milliseconds. */
 
+/* Size of the transposition table of the enemy controller. */
+const size_t AI_TABLE_SIZE = 1U << 18;
+
+/* Maximum search depth of the enemy controller, in plies. */
+const int AI_MAX_DEPTH = 32;
+
+/* Milliseconds a spectator waits before looking for a new frame again. */
+const long WATCH_POLL_MSEC = 10;
+
+/* Prints the usage of the program. */
+static void usage(const char* program)
+{
+    fprintf(stderr, "Usage: %s [--ai <microseconds> [--cache %s]] [--kill-map]\n"
+    "       [--skip-repeats] [--beam-budget %s] [--beam-msec %s]\n"
+    "       [--beam-fps %s] [--trace %s] [--broadcast %s]\n"
+    "       %s %s\n", program, "<directory>", "<steps>", "<milliseconds>",
+    "<frames>", "<trace-filename>", "<broadcast-name>", "<map-filename>",
+    "<log-filename>");
+    fprintf(stderr, "       %s --edit %s %s\n", program,
+    "<map-filename>", "<output-map-filename>");
+    fprintf(stderr, "       %s --watch %s\n", program, "<broadcast-name>");
+}
+
+/* Reads a whole argument as a number of at least 0 into value. Returns
+false, leaving value as it was, if the argument is anything else. */
+static bool parse_count(const char* text, long* value)
+{
+    char* end;
+    long number;
+
+    number = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || number < 0)
+    {
+        return false;
+    }
+    *value = number;
+    return true;
+}
+
+/* Records a move in the game log. With skip_repeats, a move which leaves
+the grid as it was in the last logged frame, such as bumping into a wall,
+is left out, since its frame would only repeat that one. */
+static void log_tank_move(pos_t from, pos_t to, char tank)
+{
+    if (skip_repeats && repeats_last_frame(&game_log, grid_hash, logged_hash))
+    {
+        return;
+    }
+
+    log_move(&game_log, from, to, tank);
+    logged_hash = grid_hash;
+}
+
+/* Draws the frames a game broadcasts until the game ends. */
+static int watch(const char* name)
+{
+    broadcast_t broadcast;
+    broadcast_status_t status;
+
+    if (!attach_broadcast(&broadcast, name))
+    {
+        return EXIT_FAILURE;
+    }
+    while ((status = poll_broadcast(&broadcast)) != BROADCAST_ENDED)
+    {
+        if (status == BROADCAST_FRAME)
+        {
+            /* The minimap shows the tanks where the game has them. */
+            system("clear");
+            draw_view(broadcast.rows, broadcast.height, broadcast.width,
+            broadcast.focus, broadcast.player, broadcast.enemy, stdout);
+        }
+        else
+        {
+            msleep(WATCH_POLL_MSEC);
+        }
+    }
+    fprintf(stdout, "The game ended.\n");
+    detach_broadcast(&broadcast);
+    return EXIT_SUCCESS;
+}
+
 /* Entry point of the program. */
 int main(int argc, char** argv)
 {
@@ -27,22 +129,148 @@ int main(int argc, char** argv)
     /* Pointer to the map. */
     char** grid = NULL;
 
+    /* Flag to indicate whether or not the log is written compressed. */
+    bool compress_log;
+
+    /* Time budget of the enemy controller per turn, in microseconds.
+    Zero keeps the classic enemy, which only fires when in line of sight. */
+    long ai_budget;
+    ai_t ai;
+    board_t board;
+
+    /* Directory caching the boards of maps, or NULL for none. */
+    const char* cache_dir = NULL;
+
+    /* Flag to indicate whether the map is edited instead of played; the
+    second filename then names the edited map instead of the log. */
+    bool edit_mode;
+    editor_t editor;
+
+    /* Flag to indicate whether the cells from which the player can hit the
+    enemy are marked on the map, and the kill map behind the marks. */
+    bool show_kill_map;
+    kill_map_t kill_map;
+
+    /* File the timeline trace is written to, or NULL for no trace. */
+    const char* trace_filename = NULL;
+
+    /* Name of the broadcast spectators watch, or NULL for none. */
+    const char* broadcast_name = NULL;
+    broadcast_t broadcast;
+
+    /* Loop counter. */
+    int i;
+
     /* Flag to indicate whether or not the game should exit. */
     bool exit_flag;
     exit_flag = false;
 
+    /* Parse options and positional arguments. */
+    ai_budget = 0;
+    edit_mode = false;
+    show_kill_map = false;
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--ai") == 0 && i + 1 < argc)
+        {
+            if (!parse_count(argv[++i], &ai_budget))
+            {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        }
+        else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc)
+        {
+            cache_dir = argv[++i];
+        }
+        else if (strcmp(argv[i], "--edit") == 0)
+        {
+            edit_mode = true;
+        }
+        else if (strcmp(argv[i], "--beam-budget") == 0 && i + 1 < argc)
+        {
+            if (!parse_count(argv[++i], &beam_step_budget))
+            {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        }
+        else if (strcmp(argv[i], "--beam-msec") == 0 && i + 1 < argc)
+        {
+            if (!parse_count(argv[++i], &beam_max_msec))
+            {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        }
+        else if (strcmp(argv[i], "--beam-fps") == 0 && i + 1 < argc)
+        {
+            if (!parse_count(argv[++i], &beam_fps) || beam_fps == 0)
+            {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        }
+        else if (strcmp(argv[i], "--skip-repeats") == 0)
+        {
+            skip_repeats = true;
+        }
+        else if (strcmp(argv[i], "--kill-map") == 0)
+        {
+            show_kill_map = true;
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            trace_filename = argv[++i];
+        }
+        else if (strcmp(argv[i], "--broadcast") == 0 && i + 1 < argc)
+        {
+            broadcast_name = argv[++i];
+        }
+        else if (strcmp(argv[i], "--watch") == 0 && i + 1 < argc)
+        {
+            return watch(argv[i + 1]);
+        }
+        else if (!map_filename)
+        {
+            /* Remember map filename. */
+            map_filename = argv[i];
+        }
+        else if (!log_filename)
+        {
+            /* Remember log filename. */
+            log_filename = argv[i];
+        }
+        else
+        {
+            map_filename = NULL;
+            break;
+        }
+    }
+
     /* Ensure proper usage. */
-    if (argc != 3)
+    if (!map_filename || !log_filename || ai_budget < 0 || beam_step_budget < 0)
     {
-        fprintf(stderr, "Usage: %s %s %s\n", argv[0], "<map-filename>","<log-filename>");
+        usage(argv[0]);
         return EXIT_FAILURE;
     }
 
-    /* Remember map filename. */
-    map_filename = argv[1];
-    
-    /* Remember log filename. */
-    log_filename = argv[2];
+    /* Logs named *.ltz are written in the compressed format. */
+    compress_log = strlen(log_filename) >= strlen(LOGZ_EXTENSION) &&
+    strcmp(log_filename + strlen(log_filename) - strlen(LOGZ_EXTENSION),
+    LOGZ_EXTENSION) == 0;
+
+    /* Record the timeline of the game. */
+    if (trace_filename)
+    {
+        start_trace();
+    }
+
+    /* Refuse maps initialize_map can't load safely. */
+    if (!check_map_file(map_filename, stderr))
+    {
+        return EXIT_FAILURE;
+    }
 
     /* Open map file for reading. */
     map = fopen(map_filename, "r");
@@ -59,7 +287,45 @@ int main(int argc, char** argv)
     grid = create_map(height, width);
 
     /* Initialize the map from input file. */
-    initialize_map(grid, height, width, map);
+    initialize_map(grid, height, width, map, &player_pos, &enemy_pos);
+
+    /* Later changes keep the hash up to date through set_cell. */
+    grid_hash = hash_grid(grid, height, width);
+
+    /* Edit the map instead of playing it. */
+    if (edit_mode)
+    {
+        start_editor(&editor, grid, height, width, &player_pos, &enemy_pos);
+        run_editor(&editor, log_filename);
+        free_editor(&editor);
+        delete_map(grid, height);
+        fclose(map);
+        return EXIT_SUCCESS;
+    }
+
+    /* Start the game log from the initial map. */
+    start_event_log(&game_log, grid, height, width);
+    logged_hash = grid_hash;
+
+    /* Let spectators watch the game. */
+    if (broadcast_name && open_broadcast(&broadcast, broadcast_name, height, width))
+    {
+        frame_broadcast = &broadcast;
+    }
+
+    /* Prepare the kill map overlay. */
+    if (show_kill_map)
+    {
+        create_kill_map(&kill_map, height, width);
+        kill_overlay = &kill_map;
+    }
+
+    /* Prepare the enemy controller. */
+    if (ai_budget > 0)
+    {
+        cached_board_from_grid(&board, grid, height, width, cache_dir, map_filename);
+        create_ai(&ai, AI_TABLE_SIZE, AI_MAX_DEPTH);
+    }
 
     /* Program loop. */
     while (!exit_flag)
@@ -67,9 +333,36 @@ int main(int argc, char** argv)
         /* Menu choice from user. */
         char menu_choice;
 
+        /* Position of a tank before it goes or faces somewhere. */
+        pos_t previous_pos;
+
+        TRACE_BEGIN("turn");
+
+        /* The enemy controller decides what the enemy tank does. */
+        if (ai_budget > 0)
+        {
+            game_state_t state;
+            char action;
+
+            state_from_grid(&state, grid, player_pos, enemy_pos);
+            action = ai_choose_action(&ai, &board, &state, TANK_ENEMY, ai_budget);
+            if (action == ACTION_FIRE)
+            {
+                enemy_fire(&exit_flag, grid, height, width);
+            }
+            else if (action != ACTION_NONE)
+            {
+                previous_pos = enemy_pos;
+                go_or_face(grid, height, width, &enemy_pos, action);
+
+                /* Log game. */
+                log_tank_move(previous_pos, enemy_pos,
+                grid[enemy_pos.x][enemy_pos.y]);
+            }
+        }
         /* If the player is in the line of sight of the enemy tank, the enemy
         tank fires at the player.*/
-        if (in_line_of_sight(player_pos, enemy_pos, grid))
+        else if (in_line_of_sight(player_pos, enemy_pos, grid))
         {
             enemy_fire(&exit_flag, grid, height, width);
         }
@@ -77,21 +370,35 @@ int main(int argc, char** argv)
         /* Check if exit flag is set by enemy tank. */
         if (exit_flag)
         {
+            TRACE_END("turn");
             break;
         }
 
+        /* The enemy may have moved; follow it with the kill map. */
+        if (show_kill_map)
+        {
+            compute_kill_map(&kill_map, grid, enemy_pos);
+        }
+
         /* Get menu choice from the user. */
         system("clear");
-        write_map(grid, height, width, stdout);
+        draw_view(grid, height, width, player_pos, player_pos, enemy_pos, stdout);
+        if (frame_broadcast)
+        {
+            /* Spectators see every frame drawn. */
+            publish_frame(frame_broadcast, grid, player_pos, player_pos, enemy_pos);
+        }
         menu_choice = menu();
+        previous_pos = player_pos;
 
         /* Go/face up. */
         if (menu_choice == 'w')
         {
             go_or_face_upward(grid);
-            
+
             /* Log game. */
-            insert_last(&game_log, grid, height, width);
+            log_tank_move(previous_pos, player_pos,
+            grid[player_pos.x][player_pos.y]);
         }
         /* Go/face down. */
         else if (menu_choice == 's')
@@ -99,7 +406,8 @@ int main(int argc, char** argv)
             go_or_face_downward(grid, height);
 
             /* Log game. */
-            insert_last(&game_log, grid, height, width);
+            log_tank_move(previous_pos, player_pos,
+            grid[player_pos.x][player_pos.y]);
         }
         /* Go/face right. */
         else if (menu_choice == 'd')
@@ -107,7 +415,8 @@ int main(int argc, char** argv)
             go_or_face_rightward(grid, width);
 
             /* Log game. */
-            insert_last(&game_log, grid, height, width);
+            log_tank_move(previous_pos, player_pos,
+            grid[player_pos.x][player_pos.y]);
         }
         /* Go/face left. */
         else if (menu_choice == 'a')
@@ -115,7 +424,8 @@ int main(int argc, char** argv)
             go_or_face_leftward(grid);
 
             /* Log game. */
-            insert_last(&game_log, grid, height, width);
+            log_tank_move(previous_pos, player_pos,
+            grid[player_pos.x][player_pos.y]);
         }
         /* Shoot laser. */
         else if (menu_choice == 'f')
@@ -126,8 +436,17 @@ int main(int argc, char** argv)
         else if (menu_choice == 'l')
         {
             /* Write the most recent log to the given log file. */
-            write_list(game_log, log_filename);
+            if (compress_log)
+            {
+                write_event_log_compressed(&game_log, log_filename);
+            }
+            else
+            {
+                write_event_log(&game_log, log_filename);
+            }
         }
+
+        TRACE_END("turn");
     }
 
     /* Free heap memory associated with map/grid. */
@@ -135,11 +454,44 @@ int main(int argc, char** argv)
     grid = NULL;    /* Just to be safe. */
 
     /* Write the most recent log to the given log file. */
-    write_list(game_log, log_filename);
+    if (compress_log)
+    {
+        write_event_log_compressed(&game_log, log_filename);
+    }
+    else
+    {
+        write_event_log(&game_log, log_filename);
+    }
+
+    /* Write the timeline of the game. */
+    if (trace_filename)
+    {
+        write_trace(trace_filename);
+    }
+
+    /* Tell spectators the game ended. */
+    if (frame_broadcast)
+    {
+        frame_broadcast = NULL;
+        close_broadcast(&broadcast);
+    }
+
+    /* Free heap memory associated with the kill map. */
+    if (show_kill_map)
+    {
+        kill_overlay = NULL;
+        free_kill_map(&kill_map);
+    }
+
+    /* Free heap memory associated with the enemy controller. */
+    if (ai_budget > 0)
+    {
+        free_ai(&ai);
+        free_board(&board);
+    }
 
     /* Free heap memory associated with game_log. */
-    free_list(game_log);
-    game_log = NULL;    /* Just to be safe. */
+    free_event_log(&game_log);
 
     /* Close file(s). */
     fclose(map);
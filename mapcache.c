@@ -0,0 +1,277 @@
+#define _POSIX_C_SOURCE 200809L
+#include "mapcache.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* "LTMC" read as a little-endian word. */
+#define MAP_CACHE_MAGIC 0x434D544CU
+
+/* Extension of cache files. */
+#define MAP_CACHE_EXTENSION ".ltc"
+
+/* Bytes of a map file hashed per read. A multiple of 8. */
+#define HASH_CHUNK 65536
+
+/** Defines the header of a cache file. The cells, path_id and path_pos
+ * arrays of the board follow at the offsets it gives. */
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    int32_t height;
+    int32_t width;
+    uint32_t id_size;       /* sizeof(int) of the writer. */
+    uint32_t pos_size;      /* sizeof(unsigned) of the writer. */
+    uint64_t cells_offset;
+    uint64_t path_id_offset;
+    uint64_t path_pos_offset;
+    uint64_t file_size;
+    uint64_t checksum;      /* Hash of the cells, path_id and path_pos arrays. */
+} cache_header_t;
+
+/* Mixes a word into a hash. */
+static uint64_t mix(uint64_t hash, uint64_t word)
+{
+    hash = (hash ^ word) * 0x9E3779B97F4A7C15ULL;
+    return hash ^ (hash >> 29);
+}
+
+/* Mixes size bytes into a hash, 8 at a time; a partial last word is
+padded with zeros. */
+static uint64_t mix_bytes(uint64_t hash, const void* data, size_t size)
+{
+    const unsigned char* bytes;
+    uint64_t word;
+    size_t k;
+
+    bytes = data;
+    for (k = 0; k + 8 <= size; k += 8)
+    {
+        memcpy(&word, bytes + k, 8);
+        hash = mix(hash, word);
+    }
+    if (k < size)
+    {
+        word = 0;
+        memcpy(&word, bytes + k, size - k);
+        hash = mix(hash, word);
+    }
+    return hash;
+}
+
+/* Returns the checksum of the arrays of a board with a given number of
+cells. */
+static uint64_t board_checksum(const char* cells, const int* path_id,
+const unsigned* path_pos, size_t count)
+{
+    uint64_t hash;
+
+    hash = mix_bytes(mix(0x4C54u, count), cells, count);
+    hash = mix_bytes(hash, path_id, count * 2 * sizeof(int));
+    return mix_bytes(hash, path_pos, count * 2 * sizeof(unsigned));
+}
+
+bool map_cache_key(const char* map_filename, unsigned long long* key)
+{
+    unsigned char* buffer;
+    uint64_t hash, length;
+    size_t count;
+    FILE* file;
+
+    file = fopen(map_filename, "rb");
+    if (!file)
+    {
+        return false;
+    }
+    buffer = malloc(HASH_CHUNK);
+
+    /* Hash 8 bytes at a time; only the last chunk has a tail. */
+    hash = mix(0x4C54u, MAP_CACHE_VERSION);
+    length = 0;
+    while ((count = fread(buffer, 1, HASH_CHUNK, file)) > 0)
+    {
+        hash = mix_bytes(hash, buffer, count);
+        length += count;
+    }
+    free(buffer);
+    if (ferror(file))
+    {
+        fclose(file);
+        return false;
+    }
+    fclose(file);
+
+    *key = mix(hash, length);
+    return true;
+}
+
+/* Fills the header of the cache file of a board of a given size, all but
+its checksum. */
+static void layout(cache_header_t* header, int height, int width, unsigned long long key)
+{
+    uint64_t cells;
+
+    cells = (uint64_t) height * width;
+    memset(header, 0, sizeof(*header));
+    header->magic = MAP_CACHE_MAGIC;
+    header->version = MAP_CACHE_VERSION;
+    header->key = key;
+    header->height = height;
+    header->width = width;
+    header->id_size = sizeof(int);
+    header->pos_size = sizeof(unsigned);
+    header->cells_offset = sizeof(cache_header_t);
+    header->path_id_offset = (header->cells_offset + cells + 7) & ~(uint64_t) 7;
+    header->path_pos_offset = header->path_id_offset + cells * 2 * sizeof(int);
+    header->file_size = header->path_pos_offset + cells * 2 * sizeof(unsigned);
+}
+
+/* Writes the name of a cache file into path. */
+static void entry_name(char* path, size_t size, const char* dir, unsigned long long key)
+{
+    snprintf(path, size, "%s/%016llx%s", dir, key, MAP_CACHE_EXTENSION);
+}
+
+bool load_cached_board(board_t* board, const char* dir, unsigned long long key)
+{
+    cache_header_t expected;
+    const cache_header_t* header;
+    char path[4096];
+    struct stat info;
+    unsigned char* data;
+    int fd;
+
+    entry_name(path, sizeof(path), dir, key);
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    if (fstat(fd, &info) != 0 || (size_t) info.st_size < sizeof(cache_header_t))
+    {
+        close(fd);
+        return false;
+    }
+
+    /* A private mapping: writes to the board never reach the file. */
+    data = mmap(NULL, (size_t) info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+
+    /* Trust nothing the header says until it matches the expected layout. */
+    header = (const cache_header_t*) data;
+    if (header->height <= 0 || header->width <= 0)
+    {
+        munmap(data, (size_t) info.st_size);
+        return false;
+    }
+    layout(&expected, header->height, header->width, key);
+    expected.checksum = header->checksum;
+    if (memcmp(header, &expected, sizeof(expected)) != 0
+    || expected.file_size != (uint64_t) info.st_size)
+    {
+        munmap(data, (size_t) info.st_size);
+        return false;
+    }
+
+    /* An entry damaged after it was written, even one of the right size,
+    would give wrong laser paths. */
+    if (board_checksum((const char*) (data + header->cells_offset),
+    (const int*) (data + header->path_id_offset),
+    (const unsigned*) (data + header->path_pos_offset),
+    (size_t) header->height * header->width) != header->checksum)
+    {
+        munmap(data, (size_t) info.st_size);
+        return false;
+    }
+
+    board->height = header->height;
+    board->width = header->width;
+    board->cells = (char*) (data + header->cells_offset);
+    board->path_id = (int*) (data + header->path_id_offset);
+    board->path_pos = (unsigned*) (data + header->path_pos_offset);
+    board->mapping = data;
+    board->mapping_size = (size_t) info.st_size;
+    return true;
+}
+
+bool store_cached_board(const board_t* board, const char* dir, unsigned long long key)
+{
+    cache_header_t header;
+    char path[4096];
+    char temp[4096 + 32];
+    size_t cells;
+    bool ok;
+    FILE* file;
+
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST)
+    {
+        fprintf(stderr, "Couldn't create cache directory %s.\n", dir);
+        return false;
+    }
+    entry_name(path, sizeof(path), dir, key);
+    snprintf(temp, sizeof(temp), "%s.%ld", path, (long) getpid());
+
+    file = fopen(temp, "wb");
+    if (!file)
+    {
+        fprintf(stderr, "Couldn't open %s for writing.\n", temp);
+        return false;
+    }
+
+    /* Header, cells, padding, then the path arrays. */
+    cells = (size_t) board->height * board->width;
+    layout(&header, board->height, board->width, key);
+    header.checksum = board_checksum(board->cells, board->path_id, board->path_pos, cells);
+    ok = fwrite(&header, sizeof(header), 1, file) == 1
+    && fwrite(board->cells, 1, cells, file) == cells;
+    while (ok && (uint64_t) ftell(file) < header.path_id_offset)
+    {
+        ok = fputc(0, file) != EOF;
+    }
+    ok = ok && fwrite(board->path_id, sizeof(int), cells * 2, file) == cells * 2
+    && fwrite(board->path_pos, sizeof(unsigned), cells * 2, file) == cells * 2;
+    ok = fclose(file) == 0 && ok;
+
+    /* Readers see either no entry or a complete one. */
+    if (!ok || rename(temp, path) != 0)
+    {
+        fprintf(stderr, "Couldn't write %s.\n", path);
+        remove(temp);
+        return false;
+    }
+    return true;
+}
+
+void cached_board_from_grid(board_t* board, char** grid, int height, int width,
+const char* dir, const char* map_filename)
+{
+    unsigned long long key;
+
+    if (!dir || !map_cache_key(map_filename, &key))
+    {
+        board_from_grid(board, grid, height, width);
+        return;
+    }
+    if (load_cached_board(board, dir, key))
+    {
+        if (board->height == height && board->width == width)
+        {
+            return;
+        }
+        free_board(board);
+    }
+    board_from_grid(board, grid, height, width);
+    store_cached_board(board, dir, key);
+}
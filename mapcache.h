@@ -0,0 +1,51 @@
+#ifndef MAPCACHE_H
+#define MAPCACHE_H
+#include <stdbool.h>
+#include "state.h"
+
+/* On-disk cache of derived map data.
+ *
+ * Labelling the laser paths of a board takes time proportional to the map,
+ * on every start. The cache keeps indexed boards in a directory, one file
+ * per map, named after a hash of the map file contents and of the cache
+ * format version. A cache file holds the arrays of board_t laid out as in
+ * memory, so a loaded board points straight into the mapped file; loading
+ * checks the header, the size of the file and a checksum of the arrays. */
+
+/* Version of the cache file layout; part of every key. */
+#define MAP_CACHE_VERSION 2U
+
+/** Computes the cache key of a map file.
+ * @param map_filename name of the map file.
+ * @param key receives a hash of the file contents and MAP_CACHE_VERSION.
+ * @return true on success, false if the file could not be read. */
+bool map_cache_key(const char* map_filename, unsigned long long* key);
+
+/** Loads an indexed board from the cache. free_board releases it.
+ * @param board board to load.
+ * @param dir cache directory.
+ * @param key cache key of the map.
+ * @return true on success, false if there is no entry or it is damaged. */
+bool load_cached_board(board_t* board, const char* dir, unsigned long long key);
+
+/** Stores an indexed board in the cache, creating the directory if needed.
+ * Concurrent writers of the same entry are safe: the entry is written to a
+ * private file which then replaces it.
+ * @param board board to store.
+ * @param dir cache directory.
+ * @param key cache key of the map.
+ * @return true on success, false with a message on stderr otherwise. */
+bool store_cached_board(const board_t* board, const char* dir, unsigned long long key);
+
+/** Creates the board of a map file like board_from_grid does, going
+ * through the cache when a cache directory is given.
+ * @param board board to initialize.
+ * @param grid pointer to the 2D array of characters representing the map.
+ * @param height number of rows in the grid.
+ * @param width number of columns in the grid.
+ * @param dir cache directory, or NULL to always build the board.
+ * @param map_filename name of the map file grid was read from. */
+void cached_board_from_grid(board_t* board, char** grid, int height, int width,
+const char* dir, const char* map_filename);
+
+#endif  /* MAPCACHE_H */
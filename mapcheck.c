@@ -0,0 +1,414 @@
+#include "mapcheck.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Longest diagnostic message. */
+#define MESSAGE_SIZE 160
+
+/* Bytes of a map file read at a time by check_map_file. */
+#define READ_CHUNK 65536
+
+/* Problems check_map_file reports per file. */
+#define MAX_FILE_ERRORS 20
+
+/** Defines the single-pass scanner over the text of a map. Tokens are
+ * split the way fscanf splits them for initialize_map: a number is an
+ * optional sign and digits, anything else is one character. */
+typedef struct
+{
+    const char* data;
+    size_t size;
+    size_t at;          /* Offset of the next unread byte. */
+    int line;           /* Position of the next unread byte. */
+    int column;
+} scanner_t;
+
+/** Defines the object already on a cell, for reporting overlaps. */
+typedef struct
+{
+    long cell;          /* x * width + y, or -1 for an empty slot. */
+    int line;
+    int column;
+} occupant_t;
+
+/** Defines the state of one check. */
+typedef struct
+{
+    scanner_t scan;
+    long height;
+    long width;
+    occupant_t* slots;  /* Open-addressed set of occupied cells. */
+    size_t capacity;    /* A power of 2. */
+    size_t count;
+    int errors;
+    int max_errors;
+    map_diagnostic_t report;
+    void* context;
+} check_t;
+
+/* Reports a problem. Returns false once no more problems are wanted. */
+static bool fail(check_t* check, int line, int column, const char* message)
+{
+    if (check->report)
+    {
+        check->report(line, column, message, check->context);
+    }
+    check->errors++;
+    return check->errors < check->max_errors;
+}
+
+/* Skips whitespace, counting lines and columns. */
+static void skip_space(scanner_t* scan)
+{
+    while (scan->at < scan->size)
+    {
+        char c = scan->data[scan->at];
+        if (c == '\n')
+        {
+            scan->line++;
+            scan->column = 1;
+        }
+        else if (c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f')
+        {
+            scan->column++;
+        }
+        else
+        {
+            return;
+        }
+        scan->at++;
+    }
+}
+
+/* Describes the next token, or the end of the file, for messages. */
+static void describe_next(const scanner_t* scan, char* text, size_t size)
+{
+    unsigned char c;
+
+    if (scan->at >= scan->size)
+    {
+        snprintf(text, size, "end of file");
+        return;
+    }
+    c = (unsigned char) scan->data[scan->at];
+    if (c >= 0x20 && c < 0x7F)
+    {
+        snprintf(text, size, "'%c'", c);
+    }
+    else
+    {
+        snprintf(text, size, "byte 0x%02X", c);
+    }
+}
+
+/* Reads a number like %d does. On success the value is stored, its size
+ * saturated at LONG_MAX; on failure nothing is consumed. */
+static bool scan_number(scanner_t* scan, long* value)
+{
+    size_t at;
+    bool negative;
+    long number;
+
+    at = scan->at;
+    negative = false;
+    if (at < scan->size && (scan->data[at] == '-' || scan->data[at] == '+'))
+    {
+        negative = scan->data[at] == '-';
+        at++;
+    }
+    if (at >= scan->size || scan->data[at] < '0' || scan->data[at] > '9')
+    {
+        return false;
+    }
+    number = 0;
+    while (at < scan->size && scan->data[at] >= '0' && scan->data[at] <= '9')
+    {
+        int digit = scan->data[at] - '0';
+        if (number <= (LONG_MAX - digit) / 10)
+        {
+            number = number * 10 + digit;
+        }
+        else
+        {
+            number = LONG_MAX;
+        }
+        at++;
+    }
+    scan->column += (int) (at - scan->at);
+    scan->at = at;
+    *value = negative ? -number : number;
+    return true;
+}
+
+/* Expects a number, reporting what was found instead. */
+static bool expect_number(check_t* check, const char* what, long* value)
+{
+    char found[32], message[MESSAGE_SIZE];
+
+    skip_space(&check->scan);
+    if (scan_number(&check->scan, value))
+    {
+        return true;
+    }
+    describe_next(&check->scan, found, sizeof(found));
+    snprintf(message, sizeof(message), "expected %s, found %s", what, found);
+    fail(check, check->scan.line, check->scan.column, message);
+    return false;
+}
+
+/* Marks a cell occupied. Returns the earlier occupant if there is one. */
+static const occupant_t* occupy(check_t* check, long cell, int line, int column)
+{
+    size_t k, mask;
+
+    /* Keep the set at most half full. */
+    if ((check->count + 1) * 2 > check->capacity)
+    {
+        occupant_t* old = check->slots;
+        size_t old_capacity = check->capacity;
+
+        check->capacity = old_capacity ? old_capacity * 2 : 64;
+        check->slots = malloc(sizeof(occupant_t) * check->capacity);
+        for (k = 0; k < check->capacity; k++)
+        {
+            check->slots[k].cell = -1;
+        }
+        mask = check->capacity - 1;
+        for (k = 0; k < old_capacity; k++)
+        {
+            if (old[k].cell >= 0)
+            {
+                size_t s = ((unsigned long) old[k].cell * 0x9E3779B97F4A7C15ULL >> 17) & mask;
+                while (check->slots[s].cell >= 0)
+                {
+                    s = (s + 1) & mask;
+                }
+                check->slots[s] = old[k];
+            }
+        }
+        free(old);
+    }
+
+    mask = check->capacity - 1;
+    k = ((unsigned long) cell * 0x9E3779B97F4A7C15ULL >> 17) & mask;
+    while (check->slots[k].cell >= 0)
+    {
+        if (check->slots[k].cell == cell)
+        {
+            return &check->slots[k];
+        }
+        k = (k + 1) & mask;
+    }
+    check->slots[k].cell = cell;
+    check->slots[k].line = line;
+    check->slots[k].column = column;
+    check->count++;
+    return NULL;
+}
+
+/* Checks one object: a position and a direction character from allowed.
+ * Returns false once checking has to stop. */
+static bool check_object(check_t* check, const char* what, const char* allowed)
+{
+    char found[32], message[MESSAGE_SIZE];
+    const occupant_t* earlier;
+    int line, column;
+    long x, y;
+    bool inside;
+    char dir;
+
+    skip_space(&check->scan);
+    line = check->scan.line;
+    column = check->scan.column;
+
+    /* A token that isn't a number leaves the reader of initialize_map
+     * stuck, so nothing after it can be trusted. */
+    if (!expect_number(check, "a row", &x) || !expect_number(check, "a column", &y))
+    {
+        return false;
+    }
+
+    skip_space(&check->scan);
+    if (check->scan.at >= check->scan.size)
+    {
+        snprintf(message, sizeof(message), "%s has no direction", what);
+        fail(check, check->scan.line, check->scan.column, message);
+        return false;
+    }
+    dir = check->scan.data[check->scan.at];
+    if (!strchr(allowed, dir) || dir == '\0')
+    {
+        describe_next(&check->scan, found, sizeof(found));
+        snprintf(message, sizeof(message), "%s direction must be one of %s, found %s",
+        what, allowed, found);
+        if (!fail(check, check->scan.line, check->scan.column, message))
+        {
+            return false;
+        }
+    }
+    check->scan.at++;
+    check->scan.column++;
+
+    inside = x >= 0 && x < check->height && y >= 0 && y < check->width;
+    if (!inside)
+    {
+        snprintf(message, sizeof(message), "%s at %ld %ld is outside the %ldx%ld map",
+        what, x, y, check->height, check->width);
+        return fail(check, line, column, message);
+    }
+    earlier = occupy(check, x * check->width + y, line, column);
+    if (earlier)
+    {
+        snprintf(message, sizeof(message), "%s at %ld %ld overlaps the object at %d:%d",
+        what, x, y, earlier->line, earlier->column);
+        return fail(check, line, column, message);
+    }
+    return true;
+}
+
+int check_map(const char* data, size_t size, int max_errors, map_diagnostic_t report,
+void* context)
+{
+    char message[MESSAGE_SIZE];
+    check_t check;
+    int line, column;
+    bool header_ok;
+
+    memset(&check, 0, sizeof(check));
+    check.scan.data = data;
+    check.scan.size = size;
+    check.scan.line = 1;
+    check.scan.column = 1;
+    check.max_errors = max_errors > 0 ? max_errors : 1;
+    check.report = report;
+    check.context = context;
+
+    /* Header: height and width. Nothing else can be checked without it. */
+    skip_space(&check.scan);
+    line = check.scan.line;
+    column = check.scan.column;
+    if (!expect_number(&check, "the map height", &check.height)
+    || !expect_number(&check, "the map width", &check.width))
+    {
+        return check.errors;
+    }
+    header_ok = false;
+    if (check.height < 1 || check.height > MAX_MAP_SIDE
+    || check.width < 1 || check.width > MAX_MAP_SIDE)
+    {
+        snprintf(message, sizeof(message), "map size %ldx%ld is not between 1 and %ld a side",
+        check.height, check.width, MAX_MAP_SIDE);
+    }
+    else if (check.height * check.width < 2)
+    {
+        snprintf(message, sizeof(message), "map size %ldx%ld has no room for two tanks",
+        check.height, check.width);
+    }
+    else if (check.height * check.width > MAX_MAP_CELLS)
+    {
+        snprintf(message, sizeof(message), "map size %ldx%ld has more than %ld cells",
+        check.height, check.width, MAX_MAP_CELLS);
+    }
+    else
+    {
+        header_ok = true;
+    }
+    if (!header_ok)
+    {
+        fail(&check, line, column, message);
+        return check.errors;
+    }
+
+    /* The tanks, then mirrors up to the end of the file. */
+    skip_space(&check.scan);
+    if (check.scan.at >= check.scan.size)
+    {
+        fail(&check, check.scan.line, check.scan.column, "map has no player tank");
+        fail(&check, check.scan.line, check.scan.column, "map has no enemy tank");
+        return check.errors;
+    }
+    if (!check_object(&check, "player tank", "udlr"))
+    {
+        free(check.slots);
+        return check.errors;
+    }
+    skip_space(&check.scan);
+    if (check.scan.at >= check.scan.size)
+    {
+        fail(&check, check.scan.line, check.scan.column, "map has no enemy tank");
+        free(check.slots);
+        return check.errors;
+    }
+    if (!check_object(&check, "enemy tank", "udlr"))
+    {
+        free(check.slots);
+        return check.errors;
+    }
+    for (;;)
+    {
+        skip_space(&check.scan);
+        if (check.scan.at >= check.scan.size || !check_object(&check, "mirror", "fb"))
+        {
+            break;
+        }
+    }
+    free(check.slots);
+    return check.errors;
+}
+
+/** Defines where check_map_file prints problems. */
+typedef struct
+{
+    const char* filename;
+    FILE* stream;
+} file_report_t;
+
+/* Prints a problem of the file described by context. */
+static void print_diagnostic(int line, int column, const char* message, void* context)
+{
+    file_report_t* target = context;
+    fprintf(target->stream, "%s:%d:%d: %s\n", target->filename, line, column, message);
+}
+
+bool check_map_file(const char* filename, FILE* stream)
+{
+    file_report_t target;
+    char* data;
+    size_t size, capacity, count;
+    FILE* file;
+    int errors;
+
+    file = fopen(filename, "rb");
+    if (!file)
+    {
+        fprintf(stream, "Couldn't open %s for reading.\n", filename);
+        return false;
+    }
+    size = 0;
+    capacity = READ_CHUNK;
+    data = malloc(capacity);
+    while ((count = fread(data + size, 1, capacity - size, file)) > 0)
+    {
+        size += count;
+        if (size == capacity)
+        {
+            capacity *= 2;
+            data = realloc(data, capacity);
+        }
+    }
+    if (ferror(file))
+    {
+        fprintf(stream, "Couldn't read %s.\n", filename);
+        fclose(file);
+        free(data);
+        return false;
+    }
+    fclose(file);
+
+    target.filename = filename;
+    target.stream = stream;
+    errors = check_map(data, size, MAX_FILE_ERRORS, print_diagnostic, &target);
+    free(data);
+    return errors == 0;
+}
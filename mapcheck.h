@@ -0,0 +1,44 @@
+#ifndef MAPCHECK_H
+#define MAPCHECK_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/* Map file checker.
+ *
+ * initialize_map trusts its input: coordinates index the grid unchecked
+ * and bad direction characters trip assertions. The checker reads the text
+ * of a map file once, token by token, and reports every problem with the
+ * line and column it was found at: a bad header, numbers which are not
+ * numbers, coordinates outside the map, objects on top of each other, bad
+ * direction characters and missing tanks. A map it accepts loads safely. */
+
+/* Largest height or width, and number of cells, of an acceptable map. */
+#define MAX_MAP_SIDE 65536L
+#define MAX_MAP_CELLS (1L << 26)
+
+/** Receives a problem found in a map.
+ * @param line line of the problem, from 1.
+ * @param column column of the problem, from 1.
+ * @param message description of the problem.
+ * @param context pointer passed through from check_map. */
+typedef void (*map_diagnostic_t)(int line, int column, const char* message, void* context);
+
+/** Checks the text of a map file.
+ * @param data contents of the file.
+ * @param size number of bytes in data.
+ * @param max_errors number of problems after which checking stops.
+ * @param report function receiving each problem, or NULL.
+ * @param context pointer passed to report.
+ * @return number of problems found; 0 if the map is valid. */
+int check_map(const char* data, size_t size, int max_errors, map_diagnostic_t report,
+void* context);
+
+/** Reads and checks a map file, printing problems as
+ * filename:line:column: message.
+ * @param filename name of the map file.
+ * @param stream stream the problems are printed to.
+ * @return true if the map is valid. */
+bool check_map_file(const char* filename, FILE* stream);
+
+#endif  /* MAPCHECK_H */
@@ -0,0 +1,177 @@
+#include "policy.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Size of the transposition table of ai policies, smaller than the
+interactive game's since many of them run at once. */
+#define POLICY_AI_TABLE_SIZE (1U << 14)
+
+/* Maximum search depth of ai policies, in plies. */
+#define POLICY_AI_MAX_DEPTH 32
+
+/* The four directions, in a fixed order. */
+static const char DIRS[] = {'u', 'd', 'l', 'r'};
+
+unsigned long long random_next(unsigned long long* rng)
+{
+    *rng ^= *rng >> 12;
+    *rng ^= *rng << 25;
+    *rng ^= *rng >> 27;
+    return *rng * 0x2545F4914F6CDD1DULL;
+}
+
+bool parse_policy(policy_t* policy, const char* spec)
+{
+    policy->script = NULL;
+    policy->script_length = 0;
+    policy->budget_usec = 0;
+
+    if (strcmp(spec, "random") == 0)
+    {
+        policy->kind = POLICY_RANDOM;
+    }
+    else if (strcmp(spec, "classic") == 0)
+    {
+        policy->kind = POLICY_CLASSIC;
+    }
+    else if (strcmp(spec, "greedy") == 0)
+    {
+        policy->kind = POLICY_GREEDY;
+    }
+    else if (strncmp(spec, "scripted:", 9) == 0)
+    {
+        policy->kind = POLICY_SCRIPTED;
+        policy->script = spec + 9;
+        policy->script_length = strlen(policy->script);
+        if (policy->script_length == 0
+        || strspn(policy->script, "udlrfn") != policy->script_length)
+        {
+            return false;
+        }
+    }
+    else if (strncmp(spec, "ai:", 3) == 0)
+    {
+        char* end;
+        policy->kind = POLICY_AI;
+        policy->budget_usec = strtol(spec + 3, &end, 10);
+        if (end == spec + 3 || *end != '\0' || policy->budget_usec <= 0)
+        {
+            return false;
+        }
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+void start_policy(policy_state_t* state, const policy_t* policy, unsigned long long seed)
+{
+    state->rng = seed ? seed : 1;
+    state->script_step = 0;
+    state->has_ai = policy->kind == POLICY_AI;
+    if (state->has_ai)
+    {
+        create_ai(&state->ai, POLICY_AI_TABLE_SIZE, POLICY_AI_MAX_DEPTH);
+    }
+}
+
+void free_policy(policy_state_t* state)
+{
+    if (state->has_ai)
+    {
+        free_ai(&state->ai);
+        state->has_ai = false;
+    }
+}
+
+/* Returns true if the other tank is in the straight line of sight of a
+tank, like in_line_of_sight does for the enemy of the interactive game. */
+static bool in_sight(const game_state_t* game, int tank)
+{
+    const tank_t* self;
+    const tank_t* other;
+
+    self = &game->tanks[tank];
+    other = &game->tanks[1 - tank];
+    if (self->pos.x == other->pos.x)
+    {
+        return (self->dir == 'r' && self->pos.y < other->pos.y)
+        || (self->dir == 'l' && other->pos.y < self->pos.y);
+    }
+    if (self->pos.y == other->pos.y)
+    {
+        return (self->dir == 'u' && other->pos.x < self->pos.x)
+        || (self->dir == 'd' && self->pos.x < other->pos.x);
+    }
+    return false;
+}
+
+char policy_action(const policy_t* policy, policy_state_t* state,
+const board_t* board, const game_state_t* game, int tank)
+{
+    int d;
+
+    switch (policy->kind)
+    {
+        case POLICY_RANDOM:
+            return "udlrf"[random_next(&state->rng) % 5];
+
+        case POLICY_CLASSIC:
+            return in_sight(game, tank) ? ACTION_FIRE : ACTION_NONE;
+
+        case POLICY_GREEDY:
+            if (state_shot_hits(board, game, tank, game->tanks[tank].dir))
+            {
+                return ACTION_FIRE;
+            }
+            for (d = 0; d < 4; d++)
+            {
+                if (state_shot_hits(board, game, tank, DIRS[d]))
+                {
+                    return DIRS[d];
+                }
+            }
+            return DIRS[random_next(&state->rng) % 4];
+
+        case POLICY_SCRIPTED:
+            return policy->script[state->script_step++ % policy->script_length];
+
+        case POLICY_AI:
+            return ai_choose_action(&state->ai, board, game, tank, policy->budget_usec);
+    }
+    return ACTION_NONE;
+}
+
+int play_game(const board_t* board, game_state_t* game, const policy_t* policies[2],
+policy_state_t* states[2], int max_turns, int* turns)
+{
+    int tank;
+
+    /* Scripts start over with every game. */
+    states[TANK_PLAYER]->script_step = 0;
+    states[TANK_ENEMY]->script_step = 0;
+
+    /* The enemy acts first in every round. */
+    tank = TANK_ENEMY;
+    for (*turns = 0; *turns < max_turns; (*turns)++)
+    {
+        char action;
+        action = policy_action(policies[tank], states[tank], board, game, tank);
+        if (action == ACTION_FIRE)
+        {
+            if (state_shot_hits(board, game, tank, game->tanks[tank].dir))
+            {
+                (*turns)++;
+                return tank;
+            }
+        }
+        else if (action != ACTION_NONE)
+        {
+            state_go_or_face(board, game, tank, action);
+        }
+        tank = 1 - tank;
+    }
+    return GAME_DRAW;
+}
@@ -0,0 +1,90 @@
+#ifndef POLICY_H
+#define POLICY_H
+#include <stdbool.h>
+#include <stddef.h>
+#include "ai.h"
+#include "state.h"
+
+/* Tank policies for simulated games.
+ *
+ * A policy is described by a spec string:
+ *   random             picks any action at random.
+ *   classic            the enemy of the interactive game: fires when the
+ *                      other tank is in its straight line of sight.
+ *   greedy             fires when a shot hits, turns to any direction from
+ *                      which a shot hits, and moves at random otherwise.
+ *   scripted:<actions> repeats a fixed sequence of actions (u/d/l/r/f/n).
+ *   ai:<microseconds>  the search-based controller of ai.h. */
+
+/** Defines the kinds of policies. */
+typedef enum
+{
+    POLICY_RANDOM,
+    POLICY_CLASSIC,
+    POLICY_GREEDY,
+    POLICY_SCRIPTED,
+    POLICY_AI
+} policy_kind_t;
+
+/** Defines a policy, as parsed from its spec. Read-only once parsed, so
+ * it can be shared between threads. */
+typedef struct
+{
+    policy_kind_t kind;
+    const char* script;     /* POLICY_SCRIPTED only. */
+    size_t script_length;
+    long budget_usec;       /* POLICY_AI only. */
+} policy_t;
+
+/** Defines the mutable state of a policy playing one tank. Never shared
+ * between threads. */
+typedef struct
+{
+    unsigned long long rng;
+    size_t script_step;
+    bool has_ai;
+    ai_t ai;
+} policy_state_t;
+
+/** Outcome of a simulated game: the index of the winning tank, or
+ * GAME_DRAW if nobody won within the turn limit. */
+#define GAME_DRAW (-1)
+
+/** Returns the next number of a xorshift64* pseudo-random sequence.
+ * @param rng state of the sequence, must not be zero. */
+unsigned long long random_next(unsigned long long* rng);
+
+/** Parses a policy spec.
+ * @param policy policy to fill.
+ * @param spec spec string, see above. It must outlive the policy.
+ * @return true if spec is valid, false otherwise. */
+bool parse_policy(policy_t* policy, const char* spec);
+
+/** Prepares the state of a policy.
+ * @param state state to prepare.
+ * @param policy policy the state belongs to.
+ * @param seed seed of the random choices of the policy. */
+void start_policy(policy_state_t* state, const policy_t* policy, unsigned long long seed);
+
+/** Frees heap memory associated with the state of a policy.
+ * @param state state prepared by start_policy. */
+void free_policy(policy_state_t* state);
+
+/** Picks the next action of a tank.
+ * @return one of u/d/l/r, ACTION_FIRE or ACTION_NONE. */
+char policy_action(const policy_t* policy, policy_state_t* state,
+const board_t* board, const game_state_t* game, int tank);
+
+/** Plays a game from a given state, the enemy moving first in each
+ * round like in the interactive game.
+ * @param board board of the game.
+ * @param game initial state, updated in place.
+ * @param policies policies of the two tanks, indexed like game_state_t::tanks.
+ * @param states states of the two policies.
+ * @param max_turns maximum number of actions before a draw is declared.
+ * @param turns receives the number of actions taken.
+ * @return index of the winning tank or GAME_DRAW. */
+int play_game(const board_t* board, game_state_t* game, const policy_t* policies[2],
+policy_state_t* states[2], int max_turns, int* turns);
+
+#endif  /* POLICY_H */
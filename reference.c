@@ -0,0 +1,591 @@
+#include "reference.h"
+#include <stdlib.h>
+#include <assert.h>
+
+/* Everything here is kept as the game first had it; see reference.h for
+the few departures. Helpers are copied, with a ref_ prefix, rather than
+shared with utils, so that changing the engine can never change the
+reference. */
+
+static char ref_get_mirror_dir(char mirror)
+{
+    switch (mirror)
+    {
+        case '/': return 'f';
+        case '\\': return 'b';
+        default: assert(false); /* Invalid player argument. */
+    }
+}
+
+static char ref_get_player_dir(char player)
+{
+    switch (player)
+    {
+        case '<': return 'l';
+        case '>': return 'r';
+        case '^': return 'u';
+        case 'v': return 'd';
+        default: assert(false); /* Invalid player argument.*/
+    }
+}
+
+static bool ref_is_mirror(char c)
+{
+    switch (c)
+    {
+        case '/':
+        case '\\': return true;
+        default: return false;
+    }
+}
+
+static bool ref_is_player(char c)
+{
+    switch (c)
+    {
+        case '<':
+        case '>':
+        case '^':
+        case 'v': return true;
+        default: return false;
+    }
+}
+
+static char ref_get_mirror(char dir)
+{
+    switch (dir)
+    {
+        case 'f': return '/';
+        case 'b': return '\\';
+        default: assert(false); /* Invalid direction argument. */
+    }
+}
+
+static char ref_get_player(char dir)
+{
+    switch (dir)
+    {
+        case 'u': return '^';   /* Up. */
+        case 'd': return 'v';   /* Down. */
+        case 'r': return '>';   /* Right. */
+        case 'l': return '<';   /* Left. */
+        default: assert(false); /* Invalid direction argument. */
+    }
+}
+
+static char** ref_create_map(int height, int width)
+{
+    /* Loop counter. */
+    int i;
+
+    /* Allocate memory to store the map. */
+    char** grid = malloc(sizeof(char*) * height);
+    for (i = 0; i < height; i++)
+    {
+        grid[i] = malloc(sizeof(char) * width);
+    }
+
+    return grid;
+}
+
+static void ref_delete_map(char** grid, int height)
+{
+    /* Loop control variable. */
+    int i;
+
+    /* Iterate over the rows. */
+    for (i = 0; i < height; i++)
+    {
+        /* Free memory for each row of the grid. */
+        free(grid[i]);
+    }
+
+    /* Free memory for the grid itself.*/
+    free(grid);
+}
+
+static char** ref_get_copy(char** grid, int height, int width)
+{
+    /* Loop control variable. */
+    int i, j;
+
+    /* Allocate memory for new map/grid. */
+    char** new_grid = malloc(sizeof(char*) * height);
+    for (i = 0; i < height; i++)
+    {
+        new_grid[i] = malloc(sizeof(char) * width);
+    }
+
+    /* Copy each grid cell over to the new grid. */
+    for (i = 0; i < height; i++)
+    {
+        for (j = 0; j < width; j++)
+        {
+            new_grid[i][j] = grid[i][j];
+        }
+    }
+
+    /* Return copy. */
+    return new_grid;
+}
+
+static void ref_initialize_map(reference_t* ref, FILE* map)
+{
+    /* Declare variable to read position and direction. */
+    int x, y;
+    char dir;
+
+    /* Declare variable to read the status of file read operation. */
+    int status;
+
+    /* Loop control variables. */
+    int i, j;
+
+    /* Set the map to empty state. */
+    for (i = 0; i < ref->height; i++)
+    {
+        for (j = 0; j < ref->width; j++)
+        {
+            ref->grid[i][j] = ' ';
+        }
+    }
+
+    /* Read player data. */
+    fscanf(map, "%d%d", &x, &y);
+    fscanf(map, " %c", &dir);
+    ref->grid[x][y] = ref_get_player(dir);
+    ref->player_pos.x = x;
+    ref->player_pos.y = y;
+
+    /* Read enemy data. */
+    fscanf(map, "%d%d", &x, &y);
+    fscanf(map, " %c", &dir);
+    ref->grid[x][y] = ref_get_player(dir);   /* As enemy tank is represented
+                                    with same symbol as the symbol of player. */
+    ref->enemy_pos.x = x;
+    ref->enemy_pos.y = y;
+
+    /* As long as there are mirrors in input file. */
+    while ((status = fscanf(map, "%d%d %c", &x, &y, &dir)) != EOF)
+    {
+        ref->grid[x][y] = ref_get_mirror(dir);
+    }
+}
+
+/* Writes a map to a log file; the original only colored lasers when
+writing to the terminal. */
+static void ref_write_map(char** grid, int height, int width, FILE* stream)
+{
+    /* Loop counter variables. */
+    int i, j;
+
+    /* Print top border. */
+    for (j = 0; j < width + 2; j++)
+    {
+        fprintf(stream, "*");
+    }
+    fprintf(stream, "\n");
+
+    /* Iterate over the rows. */
+    for (i = 0; i < height; i++)
+    {
+        fprintf(stream, "*");
+        /* Iterate over the columns. */
+        for (j = 0; j < width; j++)
+        {
+            fprintf(stream, "%c", grid[i][j]);
+        }
+        fprintf(stream, "*\n");
+    }
+
+    /* Print bottom border. */
+    for (j = 0; j < width + 2; j++)
+    {
+        fprintf(stream, "*");
+    }
+    fprintf(stream, "\n");
+}
+
+static void ref_insert_last(reference_frame_t** list, char** grid, int height, int width)
+{
+    char** new_grid;
+    reference_frame_t* new_node;
+    reference_frame_t* last;
+
+    /* Copy map. */
+    new_grid = ref_get_copy(grid, height, width);
+
+    /* Allocate a new node and store the new grid into
+    the new node. */
+    new_node = malloc(sizeof(reference_frame_t));
+    new_node->grid = new_grid;
+    new_node->height = height;
+    new_node->width = width;
+    new_node->next = NULL;
+
+    /* Insert the new node at the end of the linked list. */
+    last = *list;
+    if (*list == NULL)
+    {
+        *list = new_node;
+        return;
+    }
+
+    while (last->next != NULL)
+    {
+        last = last->next;
+    }
+    last->next = new_node;
+    return;
+}
+
+void reference_start(reference_t* ref, FILE* map)
+{
+    /* Read height and width of the map. */
+    fscanf(map, "%d%d", &ref->height, &ref->width);
+
+    /* Create map. */
+    ref->grid = ref_create_map(ref->height, ref->width);
+
+    /* Initialize the map from input file. */
+    ref_initialize_map(ref, map);
+
+    /* An empty game log. */
+    ref->game_log = NULL;
+}
+
+void reference_free(reference_t* ref)
+{
+    reference_frame_t* next;
+
+    ref_delete_map(ref->grid, ref->height);
+    ref->grid = NULL;
+    while (ref->game_log != NULL)
+    {
+        next = ref->game_log->next;
+        ref_delete_map(ref->game_log->grid, ref->game_log->height);
+        free(ref->game_log);
+        ref->game_log = next;
+    }
+}
+
+/* Walks the laser of the tank at shooter towards the tank at target,
+logging a frame per step. The enemy_fire and player_fire functions of the
+original differed only in which tank fired. Returns true on a hit. */
+static bool fire(reference_t* ref, pos_t shooter, pos_t target)
+{
+    char** grid = ref->grid;
+    int height = ref->height;
+    int width = ref->width;
+
+    /* Laser vector. */
+    pos_t laser_pos;
+    char laser_dir;
+
+    /* Initial position of the laser. */
+    laser_pos.x = shooter.x;
+    laser_pos.y = shooter.y;
+
+    /* Initial direction of the laser. */
+    laser_dir = ref_get_player_dir(grid[shooter.x][shooter.y]);
+
+    /* Laser loop. */
+    while (true)
+    {
+        /* Advance. */
+        if (laser_dir == 'u')
+        {
+            laser_pos.x--;
+        }
+        else if (laser_dir == 'd')
+        {
+            laser_pos.x++;
+        }
+        else if (laser_dir == 'l')
+        {
+            laser_pos.y--;
+        }
+        else if (laser_dir == 'r')
+        {
+            laser_pos.y++;
+        }
+
+        /* If laser is out of bounds, break. */
+        if (laser_pos.x < 0 || laser_pos.x >= height
+        || laser_pos.y < 0 || laser_pos.y >= width)
+        {
+            break;
+        }
+
+        /* If laser hits the mirror, change direction. */
+        if (ref_is_mirror(grid[laser_pos.x][laser_pos.y]))
+        {
+            /* Get mirror direction: (forward or backward slash) */
+            char mirror_dir;
+            mirror_dir = ref_get_mirror_dir(grid[laser_pos.x][laser_pos.y]);
+
+            /* Forward mirror. */
+            if (mirror_dir == 'f')
+            {
+                /* Change final laser direction based on its initial direction. */
+                if (laser_dir == 'd') laser_dir = 'l';
+                else if (laser_dir == 'u') laser_dir = 'r';
+                else if (laser_dir == 'r') laser_dir = 'u';
+                else if (laser_dir == 'l') laser_dir = 'd';
+            }
+            /* Backward mirror. */
+            else if (mirror_dir == 'b')
+            {
+                if (laser_dir == 'd') laser_dir = 'r';
+                else if (laser_dir == 'u') laser_dir = 'l';
+                else if (laser_dir == 'r') laser_dir = 'd';
+                else if (laser_dir == 'l') laser_dir = 'u';
+            }
+        }
+
+        /* If laser hits the target tank, it's over. */
+        else if (laser_pos.x == target.x && laser_pos.y == target.y)
+        {
+            return true;
+        }
+
+        /* If laser comes back to the shooter, it stops there. Not in the
+        original; see reference.h. */
+        else if (laser_pos.x == shooter.x && laser_pos.y == shooter.y)
+        {
+            break;
+        }
+        else
+        {
+            /* The laser is inside the grid, it didn't hit a mirror, and
+            and it didn't hit a tank. */
+
+            /* Print laser beam. */
+            if (laser_dir == 'u' || laser_dir == 'd')
+            {
+                grid[laser_pos.x][laser_pos.y] = '|';
+            }
+            else
+            {
+                grid[laser_pos.x][laser_pos.y] = '-';
+            }
+
+            /* Log game. */
+            ref_insert_last(&ref->game_log, grid, height, width);
+
+            grid[laser_pos.x][laser_pos.y] = ' ';
+        }
+    }
+    return false;
+}
+
+void reference_enemy_fire(reference_t* ref, bool* exit_flag)
+{
+    /* If laser hits the player tank, declare lose and exit. */
+    if (fire(ref, ref->enemy_pos, ref->player_pos))
+    {
+        *exit_flag = true;
+    }
+}
+
+void reference_player_fire(reference_t* ref, bool* exit_flag)
+{
+    /* If laser hits the enemy tank, declare win and exit. */
+    if (fire(ref, ref->player_pos, ref->enemy_pos))
+    {
+        *exit_flag = true;
+    }
+}
+
+bool reference_in_line_of_sight(pos_t player_pos, pos_t enemy_pos, char** grid)
+{
+    if (player_pos.x == enemy_pos.x)
+    {
+        /* Player is in the horizontal line of sight of the enemy tank. */
+        char enemy_dir;
+        enemy_dir = ref_get_player_dir(grid[enemy_pos.x][enemy_pos.y]);
+        if ((enemy_dir == 'r' && enemy_pos.y < player_pos.y) ||
+        (enemy_dir == 'l' && player_pos.y < enemy_pos.y))
+        {
+            /* Enemy fires. */
+            return true;
+        }
+    }
+    else if (player_pos.y == enemy_pos.y)
+    {
+        /* Player is in the vertical line of sight of the enemy tank. */
+        char enemy_dir;
+        enemy_dir = ref_get_player_dir(grid[enemy_pos.x][enemy_pos.y]);
+        if ((enemy_dir == 'u' && player_pos.x < enemy_pos.x) ||
+        (enemy_dir == 'd' && enemy_pos.x < player_pos.x))
+        {
+            /* Enemy fires. */
+            return true;
+        }
+    }
+    return false;
+}
+
+void reference_go_or_face_upward(reference_t* ref)
+{
+    char** grid = ref->grid;
+    pos_t* player_pos = &ref->player_pos;
+
+    /* If the player is not already facing upward. */
+    if (ref_get_player_dir(grid[player_pos->x][player_pos->y]) != 'u')
+    {
+        /* Face upward. */
+        grid[player_pos->x][player_pos->y] = ref_get_player('u');
+    }
+    /* Attemp to move one step upward. */
+    else
+    {
+        /* The player cannot go to the same position as that of the mirror. */
+        /* The player cannot go out of the boundary of the map. */
+        if (player_pos->x - 1 >= 0 &&
+        !ref_is_mirror(grid[player_pos->x - 1][player_pos->y]) &&
+        !ref_is_player(grid[player_pos->x - 1][player_pos->y]))
+        {
+            /* Move the player one step upward. */
+            grid[player_pos->x - 1][player_pos->y] = grid[player_pos->x][player_pos->y];
+            grid[player_pos->x][player_pos->y] = ' ';
+            player_pos->x--;
+        }
+    }
+
+    /* Log game. */
+    ref_insert_last(&ref->game_log, grid, ref->height, ref->width);
+}
+
+void reference_go_or_face_downward(reference_t* ref)
+{
+    char** grid = ref->grid;
+    pos_t* player_pos = &ref->player_pos;
+
+    /* If the player is not already facing downward. */
+    if (ref_get_player_dir(grid[player_pos->x][player_pos->y]) != 'd')
+    {
+        /* Face downward. */
+        grid[player_pos->x][player_pos->y] = ref_get_player('d');
+    }
+    /* Attemp to move one step downward. */
+    else
+    {
+        /* The player cannot go to the same position as that of the mirror. */
+        /* The player cannot go out of the boundary of the map. */
+        if (player_pos->x + 1 < ref->height &&
+        !ref_is_mirror(grid[player_pos->x + 1][player_pos->y]) &&
+        !ref_is_player(grid[player_pos->x + 1][player_pos->y]))
+        {
+            /* Move the player one step downward. */
+            grid[player_pos->x + 1][player_pos->y] = grid[player_pos->x][player_pos->y];
+            grid[player_pos->x][player_pos->y] = ' ';
+            player_pos->x++;
+        }
+    }
+
+    /* Log game. */
+    ref_insert_last(&ref->game_log, grid, ref->height, ref->width);
+}
+
+void reference_go_or_face_rightward(reference_t* ref)
+{
+    char** grid = ref->grid;
+    pos_t* player_pos = &ref->player_pos;
+
+    /* If the player is not already facing rightward. */
+    if (ref_get_player_dir(grid[player_pos->x][player_pos->y]) != 'r')
+    {
+        /* Face rightward. */
+        grid[player_pos->x][player_pos->y] = ref_get_player('r');
+    }
+    /* Attemp to move one step rightward. */
+    else
+    {
+        /* The player cannot go to the same position as that of the mirror. */
+        /* The player cannot go out of the boundary of the map. */
+        if (player_pos->y + 1 < ref->width &&
+        !ref_is_mirror(grid[player_pos->x][player_pos->y + 1]) &&
+        !ref_is_player(grid[player_pos->x][player_pos->y + 1]))
+        {
+            /* Move the player one step rightward. */
+            grid[player_pos->x][player_pos->y + 1] = grid[player_pos->x][player_pos->y];
+            grid[player_pos->x][player_pos->y] = ' ';
+            player_pos->y++;
+        }
+    }
+
+    /* Log game. */
+    ref_insert_last(&ref->game_log, grid, ref->height, ref->width);
+}
+
+void reference_go_or_face_leftward(reference_t* ref)
+{
+    char** grid = ref->grid;
+    pos_t* player_pos = &ref->player_pos;
+
+    /* If the player is not already facing leftward. */
+    if (ref_get_player_dir(grid[player_pos->x][player_pos->y]) != 'l')
+    {
+        /* Face leftward. */
+        grid[player_pos->x][player_pos->y] = ref_get_player('l');
+    }
+    /* Attemp to move one step leftward. */
+    else
+    {
+        /* The player cannot go to the same position as that of the mirror. */
+        /* The player cannot go out of the boundary of the map. */
+        if (player_pos->y - 1 >= 0 &&
+        !ref_is_mirror(grid[player_pos->x][player_pos->y - 1]) &&
+        !ref_is_player(grid[player_pos->x][player_pos->y - 1]))
+        {
+            /* Move the player one step leftward. */
+            grid[player_pos->x][player_pos->y - 1] = grid[player_pos->x][player_pos->y];
+            grid[player_pos->x][player_pos->y] = ' ';
+            player_pos->y--;
+        }
+    }
+
+    /* Log game. */
+    ref_insert_last(&ref->game_log, grid, ref->height, ref->width);
+}
+
+void reference_write_list(const reference_t* ref, const char* filename)
+{
+    /* Flag indicating whether or not a map is written. */
+    bool first_map_written;
+    const reference_frame_t* current;
+
+    /* Open file for reading. */
+    FILE* outfile;
+    outfile = fopen(filename, "w");
+    if (! outfile)
+    {
+        fprintf(stderr, "Couldn't open %s for writing.\n", filename);
+        return;
+    }
+
+    /* Traverse the linked list. */
+    first_map_written = false;
+    for (current = ref->game_log; current != NULL; current = current->next)
+    {
+        /* Print a separator line in between each snapshot of map. */
+        if (first_map_written)
+        {
+            int i;
+            fprintf(outfile,"\n");
+            for (i = 0; i < current->width + 2; i++)
+            {
+                fprintf(outfile, "-");
+            }
+            fprintf(outfile, "\n\n");
+        }
+
+        /* Write the map to file pointed to by outfile pointer. */
+        ref_write_map(current->grid, current->height, current->width, outfile);
+        first_map_written = true;
+    }
+
+    /* Close file. */
+    fclose(outfile);
+}
@@ -0,0 +1,90 @@
+#ifndef REFERENCE_H
+#define REFERENCE_H
+#include <stdio.h>
+#include <stdbool.h>
+#include "utils.h"
+
+/* Frozen reference engine.
+ *
+ * A copy of the game rules as first written: tanks going and facing
+ * around, the line of sight of the enemy, lasers walked one step at a
+ * time, and a game log keeping a full copy of the map per frame, written
+ * by write_list. It is not meant to be fast or to change; difftest runs
+ * the game engine against it, so any faster engine can be checked to log
+ * exactly the same games.
+ *
+ * It departs from the original code only where it had to:
+ * - the game state is held in a reference_t instead of globals, so both
+ *   engines can run in one program;
+ * - nothing is drawn on the terminal and nothing waits;
+ * - a laser which comes back to the tank that fired it stops there, as the
+ *   game has it; the original drew the laser over its own tank, erased it,
+ *   and could go around forever. */
+
+/** Defines one logged frame of the reference game log. */
+typedef struct reference_frame
+{
+    char** grid;
+    int height;
+    int width;
+    struct reference_frame* next;
+} reference_frame_t;
+
+/** Defines the state of a game played by the reference engine. */
+typedef struct
+{
+    char** grid;
+    int height;
+    int width;
+    pos_t player_pos;
+    pos_t enemy_pos;
+    reference_frame_t* game_log;
+} reference_t;
+
+/** Starts a game from a map file, which must be valid (see mapcheck.h).
+ * @param ref game to start.
+ * @param map file pointer for the map file, read from its start. */
+void reference_start(reference_t* ref, FILE* map);
+
+/** Frees heap memory associated with a game.
+ * @param ref game to free. */
+void reference_free(reference_t* ref);
+
+/** Returns true if the player is in the line of sight of the enemy tank.
+ * @param player_pos position of the player tank.
+ * @param enemy_pos position of the enemy tank.
+ * @param grid pointer to the 2D array of characters representing the map. */
+bool reference_in_line_of_sight(pos_t player_pos, pos_t enemy_pos, char** grid);
+
+/** Fires the laser of the enemy tank, logging a frame per laser step.
+ * @param ref game the enemy fires in.
+ * @param exit_flag set if the laser hits the player tank. */
+void reference_enemy_fire(reference_t* ref, bool* exit_flag);
+
+/** Fires the laser of the player tank, logging a frame per laser step.
+ * @param ref game the player fires in.
+ * @param exit_flag set if the laser hits the enemy tank. */
+void reference_player_fire(reference_t* ref, bool* exit_flag);
+
+/** Attempts to make the player face or go one step upward, and logs it.
+ * @param ref game the player moves in. */
+void reference_go_or_face_upward(reference_t* ref);
+
+/** Attempts to make the player face or go one step downward, and logs it.
+ * @param ref game the player moves in. */
+void reference_go_or_face_downward(reference_t* ref);
+
+/** Attempts to make the player face or go one step rightward, and logs it.
+ * @param ref game the player moves in. */
+void reference_go_or_face_rightward(reference_t* ref);
+
+/** Attempts to make the player face or go one step leftward, and logs it.
+ * @param ref game the player moves in. */
+void reference_go_or_face_leftward(reference_t* ref);
+
+/** Writes the game log to a given file in the text log format.
+ * @param ref game whose log is written.
+ * @param filename filename of the file where the log is to be written. */
+void reference_write_list(const reference_t* ref, const char* filename);
+
+#endif  /* REFERENCE_H */
@@ -1,3 +1,4 @@
+#define _POSIX_C_SOURCE 200809L
 #include "sleep.h"
 #include <sys/time.h>
 
@@ -8,3 +9,10 @@ int msleep(long tms)
     tv.tv_usec = (tms % 1000) * 1000;
     return select (0, NULL, NULL, NULL, &tv);
 }
+
+long long usec_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
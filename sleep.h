@@ -7,4 +7,7 @@
 /* Sleep for the requested number of milliseconds. */
 int msleep(long msec);
 
+/* Returns a monotonic timestamp in microseconds. */
+long long usec_now(void);
+
 #endif /* SLEEP_H */
@@ -0,0 +1,331 @@
+#define _POSIX_C_SOURCE 200809L
+#include "state.h"
+#include "beam.h"
+#include <stdlib.h>
+#include <sys/mman.h>
+
+/* Returns the axis (0: horizontal, 1: vertical) of a direction. */
+static int axis_of(char dir)
+{
+    return (dir == 'l' || dir == 'r') ? 0 : 1;
+}
+
+/* Returns true if a direction is rightward or downward. */
+static bool is_forward(char dir)
+{
+    return dir == 'r' || dir == 'd';
+}
+
+/* Returns the opposite of a direction. */
+static char opposite(char dir)
+{
+    switch (dir)
+    {
+        case 'u': return 'd';
+        case 'd': return 'u';
+        case 'l': return 'r';
+        default: return 'l';
+    }
+}
+
+/* Moves a laser one step and turns it on mirrors. Returns false once the
+laser leaves the board, true if it is on a free cell and needs no turn. */
+static bool step_laser(const board_t* board, pos_t* laser_pos, char* laser_dir)
+{
+    while (true)
+    {
+        char cell;
+        advance_laser(laser_pos, *laser_dir);
+        if (laser_pos->x < 0 || laser_pos->x >= board->height
+        || laser_pos->y < 0 || laser_pos->y >= board->width)
+        {
+            return false;
+        }
+        cell = BOARD_CELL(board, laser_pos->x, laser_pos->y);
+        if (!is_mirror(cell))
+        {
+            return true;
+        }
+        *laser_dir = reflect_laser(*laser_dir, cell);
+    }
+}
+
+/* Labels the laser path through a free cell along an axis. */
+static void index_path(board_t* board, pos_t start, int axis, int id)
+{
+    pos_t laser_pos;
+    char laser_dir;
+    char start_dir;
+    unsigned loop;
+    unsigned index;
+
+    /* Walk backward to where the path enters the map, or all the way
+    around if it is a closed loop. */
+    start_dir = axis == 0 ? 'r' : 'd';
+    laser_pos = start;
+    laser_dir = opposite(start_dir);
+    loop = 0;
+    while (step_laser(board, &laser_pos, &laser_dir))
+    {
+        if (laser_pos.x == start.x && laser_pos.y == start.y
+        && laser_dir == opposite(start_dir))
+        {
+            loop = PATH_LOOP;
+            break;
+        }
+    }
+
+    /* Walk forward from there, numbering the free cells on the way. */
+    if (loop)
+    {
+        laser_pos = start;
+        laser_dir = start_dir;
+    }
+    else
+    {
+        /* laser_pos is just outside the map; turn around to enter it. */
+        laser_dir = opposite(laser_dir);
+        if (!step_laser(board, &laser_pos, &laser_dir))
+        {
+            return;
+        }
+    }
+    index = 0;
+    do
+    {
+        size_t k;
+        k = ((size_t) laser_pos.x * board->width + laser_pos.y) * 2 + axis_of(laser_dir);
+        board->path_id[k] = id;
+        board->path_pos[k] = (index << PATH_INDEX_SHIFT) | loop
+        | (is_forward(laser_dir) ? PATH_FORWARD : 0U);
+        index++;
+    } while (step_laser(board, &laser_pos, &laser_dir)
+    && !(loop && laser_pos.x == start.x && laser_pos.y == start.y
+    && laser_dir == start_dir));
+}
+
+void board_from_grid(board_t* board, char** grid, int height, int width)
+{
+    size_t cells;
+    int i, j;
+
+    cells = (size_t) height * width;
+    board->height = height;
+    board->width = width;
+    board->cells = malloc(cells > 0 ? cells : 1);
+    board->path_id = malloc(sizeof(int) * (cells > 0 ? cells * 2 : 1));
+    board->path_pos = malloc(sizeof(unsigned) * (cells > 0 ? cells * 2 : 1));
+    board->mapping = NULL;
+    board->mapping_size = 0;
+
+    /* Keep the mirrors only; tanks and laser beams are not static. */
+    for (i = 0; i < height; i++)
+    {
+        for (j = 0; j < width; j++)
+        {
+            BOARD_CELL(board, i, j) = is_mirror(grid[i][j]) ? grid[i][j] : ' ';
+        }
+    }
+
+    index_board(board);
+}
+
+void index_board(board_t* board)
+{
+    size_t cells;
+    size_t k;
+    int id;
+
+    /* Label every laser path, once. */
+    cells = (size_t) board->height * board->width;
+    for (k = 0; k < cells * 2; k++)
+    {
+        board->path_id[k] = -1;
+    }
+    id = 0;
+    for (k = 0; k < cells * 2; k++)
+    {
+        if (board->path_id[k] < 0 && !is_mirror(board->cells[k / 2]))
+        {
+            pos_t start;
+            start.x = (int) (k / 2 / board->width);
+            start.y = (int) (k / 2 % board->width);
+            index_path(board, start, (int) (k % 2), id++);
+        }
+    }
+}
+
+void free_board(board_t* board)
+{
+    if (board->mapping)
+    {
+        munmap(board->mapping, board->mapping_size);
+        board->mapping = NULL;
+    }
+    else
+    {
+        free(board->cells);
+        free(board->path_id);
+        free(board->path_pos);
+    }
+    board->cells = NULL;
+    board->path_id = NULL;
+    board->path_pos = NULL;
+}
+
+void state_from_grid(game_state_t* state, char** grid, pos_t player_pos, pos_t enemy_pos)
+{
+    state->tanks[TANK_PLAYER].pos = player_pos;
+    state->tanks[TANK_PLAYER].dir = get_player_dir(grid[player_pos.x][player_pos.y]);
+    state->tanks[TANK_ENEMY].pos = enemy_pos;
+    state->tanks[TANK_ENEMY].dir = get_player_dir(grid[enemy_pos.x][enemy_pos.y]);
+}
+
+void state_go_or_face(const board_t* board, game_state_t* state, int tank, char dir)
+{
+    tank_t* self;
+    const tank_t* other;
+    pos_t next;
+
+    self = &state->tanks[tank];
+    other = &state->tanks[1 - tank];
+
+    /* If the tank is not already facing dir, face it. */
+    if (self->dir != dir)
+    {
+        self->dir = dir;
+        return;
+    }
+
+    /* The tank cannot go out of the map, onto a mirror or onto
+    the other tank. */
+    next = self->pos;
+    advance_laser(&next, dir);
+    if (next.x < 0 || next.x >= board->height || next.y < 0 || next.y >= board->width)
+    {
+        return;
+    }
+    if (is_mirror(BOARD_CELL(board, next.x, next.y)))
+    {
+        return;
+    }
+    if (next.x == other->pos.x && next.y == other->pos.y)
+    {
+        return;
+    }
+    self->pos = next;
+}
+
+/* Returns how far ahead of the shooter an occurrence of a cell on the
+shooter's path lies, following the laser, or -1 if the laser never gets
+there. On a closed loop everything lies ahead; what the laser reaches only
+after wrapping around comes after the rest. */
+static long long distance_ahead(unsigned from_pos, unsigned to_pos, bool forward)
+{
+    long long distance;
+
+    distance = (long long) (to_pos >> PATH_INDEX_SHIFT) - (long long) (from_pos >> PATH_INDEX_SHIFT);
+    if (!forward)
+    {
+        distance = -distance;
+    }
+    if (distance > 0)
+    {
+        return distance;
+    }
+    return (from_pos & PATH_LOOP) ? distance + (1LL << 40) : -1;
+}
+
+/* Returns true if a laser fired from shooter_pos reaches target_pos within
+beam_step_budget steps, mirrors included, as trace_beam counts them. */
+static bool hits_within_budget(const board_t* board, pos_t shooter_pos, char dir,
+pos_t target_pos)
+{
+    pos_t laser_pos;
+    char laser_dir;
+    long taken;
+
+    laser_pos = shooter_pos;
+    laser_dir = dir;
+    for (taken = 0; taken < beam_step_budget; taken++)
+    {
+        advance_laser(&laser_pos, laser_dir);
+        if (laser_pos.x < 0 || laser_pos.x >= board->height
+        || laser_pos.y < 0 || laser_pos.y >= board->width)
+        {
+            return false;
+        }
+        if (laser_pos.x == target_pos.x && laser_pos.y == target_pos.y)
+        {
+            return true;
+        }
+        if (laser_pos.x == shooter_pos.x && laser_pos.y == shooter_pos.y)
+        {
+            return false;
+        }
+        if (is_mirror(BOARD_CELL(board, laser_pos.x, laser_pos.y)))
+        {
+            laser_dir = reflect_laser(laser_dir, BOARD_CELL(board, laser_pos.x, laser_pos.y));
+        }
+    }
+    return false;
+}
+
+bool state_shot_hits(const board_t* board, const game_state_t* state, int shooter, char dir)
+{
+    pos_t shooter_pos;
+    pos_t target_pos;
+    size_t from;
+    unsigned from_pos;
+    bool forward;
+    long long target_distance, self_distance;
+    int axis;
+
+    shooter_pos = state->tanks[shooter].pos;
+    target_pos = state->tanks[1 - shooter].pos;
+
+    /* Find the path the laser leaves on and which way it travels along it. */
+    from = ((size_t) shooter_pos.x * board->width + shooter_pos.y) * 2 + axis_of(dir);
+    from_pos = board->path_pos[from];
+    forward = ((from_pos & PATH_FORWARD) != 0) == is_forward(dir);
+
+    /* The laser hits the target if the target lies ahead on the same path
+    along either axis, and the path doesn't cross the shooter first. */
+    target_distance = -1;
+    self_distance = -1;
+    for (axis = 0; axis < 2; axis++)
+    {
+        size_t to;
+        long long distance;
+
+        to = ((size_t) target_pos.x * board->width + target_pos.y) * 2 + axis;
+        if (board->path_id[to] == board->path_id[from])
+        {
+            distance = distance_ahead(from_pos, board->path_pos[to], forward);
+            if (distance > 0 && (target_distance < 0 || distance < target_distance))
+            {
+                target_distance = distance;
+            }
+        }
+
+        to = ((size_t) shooter_pos.x * board->width + shooter_pos.y) * 2 + axis;
+        if (to != from && board->path_id[to] == board->path_id[from])
+        {
+            self_distance = distance_ahead(from_pos, board->path_pos[to], forward);
+        }
+    }
+    if (target_distance <= 0 || (self_distance >= 0 && self_distance < target_distance))
+    {
+        return false;
+    }
+
+    /* A laser cut short by the step budget may not get there. Paths count
+    free cells only, so a target further than the budget along an open path
+    is out of reach; otherwise it takes walking the laser to tell. */
+    if (beam_step_budget > 0)
+    {
+        return ((from_pos & PATH_LOOP) || target_distance <= beam_step_budget)
+        && hits_within_budget(board, shooter_pos, dir, target_pos);
+    }
+    return true;
+}
@@ -0,0 +1,105 @@
+#ifndef STATE_H
+#define STATE_H
+#include <stdbool.h>
+#include <stddef.h>
+#include "utils.h"
+
+/* Compact game state.
+ *
+ * Mirrors never move during a game, so they are kept once in a board
+ * while everything that changes from turn to turn (the two tanks) fits
+ * in a small game_state_t which is cheap to copy, hash and compare.
+ * Searching and simulating games works on these instead of on the
+ * character grid of the interactive game. */
+
+/** Index of the player tank in game_state_t::tanks. */
+#define TANK_PLAYER 0
+
+/** Index of the enemy tank in game_state_t::tanks. */
+#define TANK_ENEMY 1
+
+/** Defines the static part of a map: its dimensions and mirrors.
+ *
+ * Since mirrors only ever turn a laser by 90 degrees, every laser path
+ * either runs from one edge of the map to another or is a closed loop,
+ * and every free cell lies on exactly one path per axis. The board keeps,
+ * for each free cell and axis, the path it lies on and its position along
+ * that path, so whether a shot hits is answered without tracing it. */
+typedef struct
+{
+    int height;
+    int width;
+    char* cells;        /* height * width cells, a mirror or ' '. */
+    int* path_id;       /* 2 per cell: horizontal and vertical axis. */
+    unsigned* path_pos; /* 2 per cell, see PATH_* below. */
+    void* mapping;      /* Cache file holding the arrays, or NULL if on the heap. */
+    size_t mapping_size;
+} board_t;
+
+/* Layout of board_t::path_pos: the index of the cell along its path, a
+flag for closed loops and a flag telling whether the path runs rightward
+or downward through the cell as its index grows. */
+#define PATH_FORWARD 1U
+#define PATH_LOOP 2U
+#define PATH_INDEX_SHIFT 2
+
+/** Defines a tank: its position and the direction (u/d/l/r) it faces. */
+typedef struct
+{
+    pos_t pos;
+    char dir;
+} tank_t;
+
+/** Defines the dynamic part of a game. */
+typedef struct
+{
+    tank_t tanks[2];
+} game_state_t;
+
+/** Creates a board holding the mirrors of a map and indexes its laser paths.
+ * @param board board to initialize.
+ * @param grid pointer to the 2D array of characters representing the map.
+ * @param height number of rows in the grid.
+ * @param width number of columns in the grid. */
+void board_from_grid(board_t* board, char** grid, int height, int width);
+
+/** Labels the laser paths of a board whose cells were filled or changed.
+ * @param board board with height, width and cells set and path_id and
+ * path_pos allocated for 2 * height * width entries each. */
+void index_board(board_t* board);
+
+/** Frees heap memory associated with a board.
+ * @param board board to free. */
+void free_board(board_t* board);
+
+/** Returns the cell of a board at a given position. */
+#define BOARD_CELL(board, x, y) ((board)->cells[(size_t) (x) * (board)->width + (y)])
+
+/** Reads the tanks of a map into a game state.
+ * @param state game state to fill.
+ * @param grid pointer to the 2D array of characters representing the map.
+ * @param player_pos position of the player tank.
+ * @param enemy_pos position of the enemy tank. */
+void state_from_grid(game_state_t* state, char** grid, pos_t player_pos, pos_t enemy_pos);
+
+/** Makes a tank face a direction, or go one step in that direction if it
+ * already faces it, exactly like the go_or_face_* functions do.
+ * @param board board of the game.
+ * @param state game state, updated in place.
+ * @param tank index of the tank (TANK_PLAYER or TANK_ENEMY).
+ * @param dir direction to go or face (u/d/l/r). */
+void state_go_or_face(const board_t* board, game_state_t* state, int tank, char dir);
+
+/** Returns true if the laser of a tank hits the other tank when fired
+ * with the tank facing a given direction. Takes constant time, or up to
+ * beam_step_budget steps when a budget is set and the laser may hit.
+ * @param board board of the game.
+ * @param state game state.
+ * @param shooter index of the firing tank.
+ * @param dir direction the laser leaves the shooter in.
+ * @return true if the laser hits the other tank, false if it leaves
+ * the map, comes back to the shooter, which stops it, or runs out of
+ * beam_step_budget first. */
+bool state_shot_hits(const board_t* board, const game_state_t* state, int shooter, char dir);
+
+#endif  /* STATE_H */
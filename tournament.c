@@ -0,0 +1,503 @@
+#define _POSIX_C_SOURCE 200809L
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "mapcache.h"
+#include "mapcheck.h"
+#include "policy.h"
+#include "sleep.h"
+#include "state.h"
+#include "utils.h"
+
+/* Maximum number of supplied maps. */
+#define MAX_MAPS 256
+
+/* Defines a supplied map: its board and the initial state of the tanks. */
+typedef struct
+{
+    board_t board;
+    game_state_t start;
+} map_t;
+
+/* Defines the settings of a tournament, shared read-only by all threads. */
+typedef struct
+{
+    long games;
+    int threads;
+    int max_turns;
+    unsigned long long seed;
+    policy_t policies[2];
+
+    /* Supplied maps, or the shape of generated ones if there are none. */
+    map_t maps[MAX_MAPS];
+    int map_count;
+    int height;
+    int width;
+    int mirror_percent;
+} settings_t;
+
+/* Defines the work and results of one thread. The thread counts in
+locals and stores its results here once, when its games are done, so
+workers next to each other in memory don't share cache lines while
+they play. */
+typedef struct
+{
+    pthread_t thread;
+    bool started;   /* False if the games were played without a thread. */
+    const settings_t* settings;
+    long first_game;
+    long game_count;
+
+    long wins[2];
+    long draws;
+    long* lengths;  /* Histogram of game lengths, max_turns + 1 entries. */
+} worker_t;
+
+/* Prints the usage of the program. */
+static void usage(const char* program, FILE* stream)
+{
+    fprintf(stream, "Usage: %s [options]\n", program);
+    fprintf(stream, "  --games <n>          games to play (default 100000)\n");
+    fprintf(stream, "  --threads <n>        threads to use (default: all cores)\n");
+    fprintf(stream, "  --player <policy>    policy of the player (default greedy)\n");
+    fprintf(stream, "  --enemy <policy>     policy of the enemy (default classic)\n");
+    fprintf(stream, "  --map <filename>     play on a map file; repeat for more maps\n");
+    fprintf(stream, "  --cache <directory>  cache the indexed boards of map files\n");
+    fprintf(stream, "  --size <h>x<w>       size of generated maps (default 12x10)\n");
+    fprintf(stream, "  --mirrors <percent>  mirror density of generated maps (default 15)\n");
+    fprintf(stream, "  --max-turns <n>      turns before a game is a draw (default 200)\n");
+    fprintf(stream, "  --seed <n>           seed of the random choices (default 1)\n");
+    fprintf(stream, "  --help               print this help\n");
+    fprintf(stream, "Policies: random, classic, greedy, scripted:<udlrfn...>, ai:<microseconds>\n");
+}
+
+/* Reads a whole argument as a number between min and max into value.
+Returns false, leaving value as it was, if the argument is anything else. */
+static bool parse_number(const char* text, long min, long max, long* value)
+{
+    char* end;
+    long number;
+
+    number = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || number < min || number > max)
+    {
+        return false;
+    }
+    *value = number;
+    return true;
+}
+
+/* Reads a map file, going through the board cache in cache_dir unless it
+is NULL. Returns false if it can't be opened or isn't a valid map. */
+static bool load_map(map_t* map, const char* filename, const char* cache_dir)
+{
+    FILE* file;
+    char** grid;
+    pos_t player_pos, enemy_pos;
+    int height, width;
+
+    if (!check_map_file(filename, stderr))
+    {
+        return false;
+    }
+    file = fopen(filename, "r");
+    if (! file)
+    {
+        fprintf(stderr, "Couldn't open %s for reading.\n", filename);
+        return false;
+    }
+    if (fscanf(file, "%d%d", &height, &width) != 2 || height <= 0 || width <= 0)
+    {
+        fprintf(stderr, "%s has no valid dimensions.\n", filename);
+        fclose(file);
+        return false;
+    }
+    grid = create_map(height, width);
+    initialize_map(grid, height, width, file, &player_pos, &enemy_pos);
+    cached_board_from_grid(&map->board, grid, height, width, cache_dir, filename);
+    state_from_grid(&map->start, grid, player_pos, enemy_pos);
+    delete_map(grid, height);
+    fclose(file);
+    return true;
+}
+
+/* Fills a board with random mirrors and places two tanks on it. The
+board's arrays must be allocated for the generated size. */
+static void generate_map(board_t* board, game_state_t* start, int mirror_percent,
+unsigned long long* rng)
+{
+    size_t cells, k;
+    size_t tank_cells[2];
+    int t;
+
+    cells = (size_t) board->height * board->width;
+    for (k = 0; k < cells; k++)
+    {
+        unsigned long long r;
+        r = random_next(rng);
+        if ((int) (r % 100) < mirror_percent)
+        {
+            board->cells[k] = (r >> 32) & 1 ? '/' : '\\';
+        }
+        else
+        {
+            board->cells[k] = ' ';
+        }
+    }
+
+    /* Tanks go on two distinct cells, clearing any mirror there. */
+    tank_cells[0] = random_next(rng) % cells;
+    do
+    {
+        tank_cells[1] = random_next(rng) % cells;
+    } while (tank_cells[1] == tank_cells[0]);
+    for (t = 0; t < 2; t++)
+    {
+        board->cells[tank_cells[t]] = ' ';
+        start->tanks[t].pos.x = (int) (tank_cells[t] / board->width);
+        start->tanks[t].pos.y = (int) (tank_cells[t] % board->width);
+        start->tanks[t].dir = "udlr"[random_next(rng) % 4];
+    }
+    index_board(board);
+}
+
+/* Plays the games of one worker. */
+static void* run_worker(void* arg)
+{
+    worker_t* worker;
+    const settings_t* settings;
+    policy_state_t policy_states[2];
+    policy_state_t* states[2];
+    const policy_t* policies[2];
+    board_t generated;
+    unsigned long long rng;
+    long wins[2], draws;
+    long* lengths;
+    long game;
+    int t;
+
+    worker = arg;
+    settings = worker->settings;
+    wins[0] = wins[1] = draws = 0;
+    lengths = calloc(settings->max_turns + 1, sizeof(long));
+
+    /* Per-thread random sequence and policy states. */
+    rng = settings->seed * 0x9E3779B97F4A7C15ULL + (unsigned long long) worker->first_game + 1;
+    for (t = 0; t < 2; t++)
+    {
+        start_policy(&policy_states[t], &settings->policies[t], random_next(&rng));
+        states[t] = &policy_states[t];
+        policies[t] = &settings->policies[t];
+    }
+
+    /* Generated maps reuse one board per thread. */
+    if (settings->map_count == 0)
+    {
+        size_t cells;
+        cells = (size_t) settings->height * settings->width;
+        generated.height = settings->height;
+        generated.width = settings->width;
+        generated.cells = malloc(cells);
+        generated.path_id = malloc(sizeof(int) * cells * 2);
+        generated.path_pos = malloc(sizeof(unsigned) * cells * 2);
+        generated.mapping = NULL;
+    }
+
+    for (game = 0; game < worker->game_count; game++)
+    {
+        const board_t* board;
+        game_state_t state;
+        int winner, turns;
+
+        if (settings->map_count > 0)
+        {
+            const map_t* map;
+            map = &settings->maps[(worker->first_game + game) % settings->map_count];
+            board = &map->board;
+            state = map->start;
+        }
+        else
+        {
+            generate_map(&generated, &state, settings->mirror_percent, &rng);
+            board = &generated;
+
+            /* The board changed under the same pointer. */
+            for (t = 0; t < 2; t++)
+            {
+                if (policy_states[t].has_ai)
+                {
+                    clear_ai(&policy_states[t].ai);
+                }
+            }
+        }
+
+        winner = play_game(board, &state, policies, states, settings->max_turns, &turns);
+        if (winner == GAME_DRAW)
+        {
+            draws++;
+        }
+        else
+        {
+            wins[winner]++;
+        }
+        lengths[turns]++;
+    }
+    worker->wins[0] = wins[0];
+    worker->wins[1] = wins[1];
+    worker->draws = draws;
+    worker->lengths = lengths;
+
+    if (settings->map_count == 0)
+    {
+        free_board(&generated);
+    }
+    for (t = 0; t < 2; t++)
+    {
+        free_policy(&policy_states[t]);
+    }
+    return NULL;
+}
+
+/* Returns the smallest length such that at least percent of the games
+were at most that long. */
+static int percentile(const long* lengths, int max_turns, long games, int percent)
+{
+    long seen, needed;
+    int length;
+
+    needed = (games * percent + 99) / 100;
+    seen = 0;
+    for (length = 0; length <= max_turns; length++)
+    {
+        seen += lengths[length];
+        if (seen >= needed && seen > 0)
+        {
+            return length;
+        }
+    }
+    return max_turns;
+}
+
+/* Plays games between two policies and reports throughput and outcomes. */
+int main(int argc, char** argv)
+{
+    static settings_t settings;
+    const char* player_spec = "greedy";
+    const char* enemy_spec = "classic";
+    const char* map_files[MAX_MAPS];
+    const char* cache_dir = NULL;
+    worker_t* workers;
+    long* lengths;
+    long wins[2], draws;
+    long long start, elapsed;
+    long number;
+    int length;
+    int i, t;
+
+    /* Defaults. */
+    settings.games = 100000;
+    settings.threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    settings.max_turns = 200;
+    settings.seed = 1;
+    settings.map_count = 0;
+    settings.height = 12;
+    settings.width = 10;
+    settings.mirror_percent = 15;
+
+    /* Parse options. */
+    for (i = 1; i < argc; i++)
+    {
+        const char* value;
+        if (strcmp(argv[i], "--help") == 0)
+        {
+            usage(argv[0], stdout);
+            return EXIT_SUCCESS;
+        }
+        value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!value)
+        {
+            usage(argv[0], stderr);
+            return EXIT_FAILURE;
+        }
+
+        if (strcmp(argv[i], "--games") == 0)
+        {
+            if (!parse_number(value, 1, LONG_MAX, &settings.games))
+            {
+                usage(argv[0], stderr);
+                return EXIT_FAILURE;
+            }
+        }
+        else if (strcmp(argv[i], "--threads") == 0)
+        {
+            if (!parse_number(value, 1, INT_MAX, &number))
+            {
+                usage(argv[0], stderr);
+                return EXIT_FAILURE;
+            }
+            settings.threads = (int) number;
+        }
+        else if (strcmp(argv[i], "--player") == 0)
+        {
+            player_spec = value;
+        }
+        else if (strcmp(argv[i], "--enemy") == 0)
+        {
+            enemy_spec = value;
+        }
+        else if (strcmp(argv[i], "--map") == 0)
+        {
+            if (settings.map_count == MAX_MAPS)
+            {
+                fprintf(stderr, "At most %d maps are supported.\n", MAX_MAPS);
+                return EXIT_FAILURE;
+            }
+            map_files[settings.map_count++] = value;
+        }
+        else if (strcmp(argv[i], "--cache") == 0)
+        {
+            cache_dir = value;
+        }
+        else if (strcmp(argv[i], "--size") == 0)
+        {
+            length = 0;
+            if (sscanf(value, "%dx%d%n", &settings.height, &settings.width, &length) != 2
+            || value[length] != '\0')
+            {
+                usage(argv[0], stderr);
+                return EXIT_FAILURE;
+            }
+        }
+        else if (strcmp(argv[i], "--mirrors") == 0)
+        {
+            if (!parse_number(value, 0, 100, &number))
+            {
+                usage(argv[0], stderr);
+                return EXIT_FAILURE;
+            }
+            settings.mirror_percent = (int) number;
+        }
+        else if (strcmp(argv[i], "--max-turns") == 0)
+        {
+            if (!parse_number(value, 1, INT_MAX - 1, &number))
+            {
+                usage(argv[0], stderr);
+                return EXIT_FAILURE;
+            }
+            settings.max_turns = (int) number;
+        }
+        else if (strcmp(argv[i], "--seed") == 0)
+        {
+            char* end;
+            settings.seed = strtoull(value, &end, 10);
+            if (value[0] < '0' || value[0] > '9' || *end != '\0')
+            {
+                usage(argv[0], stderr);
+                return EXIT_FAILURE;
+            }
+        }
+        else
+        {
+            usage(argv[0], stderr);
+            return EXIT_FAILURE;
+        }
+        i++;
+    }
+
+    /* Read the maps once all options, the cache among them, are known. */
+    for (i = 0; i < settings.map_count; i++)
+    {
+        if (!load_map(&settings.maps[i], map_files[i], cache_dir))
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
+    /* Validate settings. */
+    if (!parse_policy(&settings.policies[TANK_PLAYER], player_spec)
+    || !parse_policy(&settings.policies[TANK_ENEMY], enemy_spec))
+    {
+        fprintf(stderr, "Invalid policy.\n");
+        usage(argv[0], stderr);
+        return EXIT_FAILURE;
+    }
+    if (settings.games <= 0 || settings.max_turns <= 0
+    || settings.height <= 0 || settings.width <= 0
+    || (long) settings.height * settings.width < 2)
+    {
+        usage(argv[0], stderr);
+        return EXIT_FAILURE;
+    }
+    if (settings.threads <= 0)
+    {
+        settings.threads = 1;
+    }
+    if (settings.threads > settings.games)
+    {
+        settings.threads = (int) settings.games;
+    }
+
+    /* Split the games evenly between the workers. */
+    workers = calloc(settings.threads, sizeof(worker_t));
+    start = usec_now();
+    for (t = 0; t < settings.threads; t++)
+    {
+        workers[t].settings = &settings;
+        workers[t].first_game = settings.games * t / settings.threads;
+        workers[t].game_count = settings.games * (t + 1) / settings.threads
+        - workers[t].first_game;
+        workers[t].started = pthread_create(&workers[t].thread, NULL, run_worker,
+        &workers[t]) == 0;
+        if (!workers[t].started)
+        {
+            fprintf(stderr, "Couldn't start thread %d; playing its games here.\n", t);
+            run_worker(&workers[t]);
+        }
+    }
+
+    /* Merge the results once every worker is done. */
+    lengths = calloc(settings.max_turns + 1, sizeof(long));
+    wins[0] = wins[1] = draws = 0;
+    for (t = 0; t < settings.threads; t++)
+    {
+        if (workers[t].started)
+        {
+            pthread_join(workers[t].thread, NULL);
+        }
+        wins[0] += workers[t].wins[0];
+        wins[1] += workers[t].wins[1];
+        draws += workers[t].draws;
+        for (i = 0; i <= settings.max_turns; i++)
+        {
+            lengths[i] += workers[t].lengths[i];
+        }
+        free(workers[t].lengths);
+    }
+    elapsed = usec_now() - start;
+
+    /* Report. */
+    printf("games:        %ld on %d thread(s) in %.3f s (%.0f games/sec)\n",
+    settings.games, settings.threads, elapsed / 1e6,
+    settings.games / (elapsed > 0 ? elapsed / 1e6 : 1e-6));
+    printf("player (%s): %ld wins (%.2f%%)\n", player_spec, wins[TANK_PLAYER],
+    100.0 * wins[TANK_PLAYER] / settings.games);
+    printf("enemy (%s):  %ld wins (%.2f%%)\n", enemy_spec, wins[TANK_ENEMY],
+    100.0 * wins[TANK_ENEMY] / settings.games);
+    printf("draws:        %ld (%.2f%%)\n", draws, 100.0 * draws / settings.games);
+    printf("game length:  p50 %d, p90 %d, p99 %d turns\n",
+    percentile(lengths, settings.max_turns, settings.games, 50),
+    percentile(lengths, settings.max_turns, settings.games, 90),
+    percentile(lengths, settings.max_turns, settings.games, 99));
+
+    /* Clean up. */
+    for (i = 0; i < settings.map_count; i++)
+    {
+        free_board(&settings.maps[i].board);
+    }
+    free(lengths);
+    free(workers);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,191 @@
+#define _POSIX_C_SOURCE 200809L
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Most events kept per thread; later ones are counted as dropped so that a
+ * forgotten trace cannot eat all memory. Room for the end of every kept
+ * span is reserved when the span begins, so a span is either dropped with
+ * its end or kept and closed. */
+#define TRACE_MAX_EVENTS (1U << 22)
+
+/** Defines a recorded event. */
+typedef struct
+{
+    const char* name;
+    long long ns;       /* Nanoseconds since start_trace. */
+    char phase;
+} trace_record_t;
+
+/** Defines the event buffer of a thread. Only its thread writes to it. */
+typedef struct trace_buffer
+{
+    trace_record_t* records;
+    size_t count;
+    size_t capacity;
+    size_t dropped;
+    size_t open;            /* Kept spans not ended yet; their ends have room. */
+    size_t open_dropped;    /* Dropped spans not ended yet. */
+    unsigned tid;
+    struct trace_buffer* next;      /* Next buffer in the list of all threads. */
+} trace_buffer_t;
+
+bool trace_enabled = false;
+
+/* Buffers of all threads which recorded events, pushed without a lock. */
+static trace_buffer_t* buffers = NULL;
+static unsigned thread_count = 0;
+static long long start_ns;
+
+/* Buffer of the calling thread, NULL until its first event. */
+static __thread trace_buffer_t* local_buffer = NULL;
+
+/* Returns a monotonic timestamp in nanoseconds. */
+static long long ns_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Creates the buffer of the calling thread and adds it to the list. */
+static trace_buffer_t* create_buffer(void)
+{
+    trace_buffer_t* buffer;
+
+    buffer = calloc(1, sizeof(trace_buffer_t));
+    if (!buffer)
+    {
+        return NULL;
+    }
+    buffer->tid = __atomic_add_fetch(&thread_count, 1U, __ATOMIC_RELAXED);
+    buffer->next = __atomic_load_n(&buffers, __ATOMIC_ACQUIRE);
+    while (!__atomic_compare_exchange_n(&buffers, &buffer->next, buffer, false,
+    __ATOMIC_RELEASE, __ATOMIC_ACQUIRE))
+    {
+        /* buffer->next was reloaded; try again. */
+    }
+    return buffer;
+}
+
+void start_trace(void)
+{
+    start_ns = ns_now();
+    trace_enabled = true;
+}
+
+void trace_event(const char* name, char phase)
+{
+    trace_buffer_t* buffer;
+    trace_record_t* record;
+
+    buffer = local_buffer;
+    if (!buffer)
+    {
+        buffer = local_buffer = create_buffer();
+        if (!buffer)
+        {
+            return;
+        }
+    }
+
+    /* The end of a dropped span is dropped too; spans inside a dropped
+    one are dropped whole. */
+    if (buffer->open_dropped > 0)
+    {
+        buffer->open_dropped += phase == 'B' ? 1 : -1;
+        buffer->dropped++;
+        return;
+    }
+
+    /* A span begins only if it and the ends of all open spans fit. Grow
+    the buffer for that, or give up once it is at its limit. */
+    if (phase == 'B' && buffer->count + buffer->open + 2 > buffer->capacity)
+    {
+        trace_record_t* records;
+        size_t capacity;
+
+        capacity = buffer->capacity ? buffer->capacity * 2 : 4096;
+        records = capacity <= TRACE_MAX_EVENTS
+        ? realloc(buffer->records, sizeof(trace_record_t) * capacity) : NULL;
+        if (!records)
+        {
+            buffer->open_dropped++;
+            buffer->dropped++;
+            return;
+        }
+        buffer->records = records;
+        buffer->capacity = capacity;
+    }
+    if (phase == 'B')
+    {
+        buffer->open++;
+    }
+    else if (buffer->open > 0)
+    {
+        buffer->open--;
+    }
+    else if (buffer->count == buffer->capacity)
+    {
+        /* An end without a begin, and no room left for it. */
+        buffer->dropped++;
+        return;
+    }
+
+    record = &buffer->records[buffer->count++];
+    record->name = name;
+    record->phase = phase;
+    record->ns = ns_now() - start_ns;
+}
+
+bool write_trace(const char* filename)
+{
+    const trace_buffer_t* buffer;
+    bool first;
+    FILE* outfile;
+
+    outfile = fopen(filename, "w");
+    if (!outfile)
+    {
+        fprintf(stderr, "Couldn't open %s for writing.\n", filename);
+        return false;
+    }
+
+    fprintf(outfile, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    first = true;
+    for (buffer = __atomic_load_n(&buffers, __ATOMIC_ACQUIRE); buffer;
+    buffer = buffer->next)
+    {
+        size_t k;
+
+        /* Name the thread, and tell how many events did not fit. */
+        fprintf(outfile, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+        "\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}", first ? "" : ",\n",
+        buffer->tid, buffer->tid);
+        first = false;
+        if (buffer->dropped > 0)
+        {
+            fprintf(stderr, "Trace of thread %u dropped %lu events.\n",
+            buffer->tid, (unsigned long) buffer->dropped);
+        }
+
+        /* Chrome wants timestamps in microseconds; keep the nanoseconds. */
+        for (k = 0; k < buffer->count; k++)
+        {
+            const trace_record_t* record;
+            record = &buffer->records[k];
+            fprintf(outfile, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lld.%03lld,"
+            "\"pid\":1,\"tid\":%u}", record->name, record->phase,
+            record->ns / 1000, record->ns % 1000, buffer->tid);
+        }
+    }
+    fprintf(outfile, "\n]}\n");
+
+    if (fclose(outfile) != 0)
+    {
+        fprintf(stderr, "Couldn't write %s.\n", filename);
+        return false;
+    }
+    return true;
+}
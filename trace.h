@@ -0,0 +1,42 @@
+#ifndef TRACE_H
+#define TRACE_H
+#include <stdbool.h>
+
+/* Timeline tracing.
+ *
+ * TRACE_BEGIN and TRACE_END record the beginning and end of a named span
+ * into a buffer owned by the calling thread, so recording never takes a
+ * lock. While tracing is off each macro costs one test of a global flag;
+ * building with -DNO_TRACE removes them altogether. write_trace dumps the
+ * buffers of all threads as Chrome trace-event JSON, which Perfetto and
+ * chrome://tracing can open. */
+
+/** True while events are recorded. Set by start_trace. */
+extern bool trace_enabled;
+
+#ifdef NO_TRACE
+#define TRACE_BEGIN(name) ((void) 0)
+#define TRACE_END(name) ((void) 0)
+#else
+/** Records the beginning of a span. name must be a string literal. */
+#define TRACE_BEGIN(name) do { if (trace_enabled) trace_event((name), 'B'); } while (0)
+/** Records the end of the innermost span, which must have the same name. */
+#define TRACE_END(name) do { if (trace_enabled) trace_event((name), 'E'); } while (0)
+#endif
+
+/** Starts recording events; timestamps count from this call. */
+void start_trace(void);
+
+/** Records an event in the buffer of the calling thread. Use the
+ * TRACE_BEGIN and TRACE_END macros rather than calling this directly.
+ * @param name name of the span, which must outlive the trace.
+ * @param phase 'B' for begin, 'E' for end. */
+void trace_event(const char* name, char phase);
+
+/** Writes all recorded events as Chrome trace-event JSON. Threads which
+ * recorded events must not be recording anymore.
+ * @param filename name of the file to write.
+ * @return true on success, false if the file could not be written. */
+bool write_trace(const char* filename);
+
+#endif  /* TRACE_H */
@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "linkedlist.h"
+#include "logcodec.h"
+#include "utils.h"
+
+/* Decompresses a compressed game log back to the text log format. */
+int main(int argc, char** argv)
+{
+    /* Declare filenames and file pointers. */
+    const char* in_filename = NULL;
+    const char* out_filename = NULL;
+    FILE* infile = NULL;
+    FILE* outfile = NULL;
+
+    /* Decoder and a grid to decode frames into. */
+    logz_reader_t reader;
+    char** grid = NULL;
+
+    /* Flag indicating whether or not a map is written. */
+    bool first_map_written;
+
+    /* What the last read found. */
+    logz_status_t status;
+
+    /* Ensure proper usage. */
+    if (argc != 3)
+    {
+        fprintf(stderr, "Usage: %s %s %s\n", argv[0], "<compressed-log>", "<text-log>");
+        return EXIT_FAILURE;
+    }
+    in_filename = argv[1];
+    out_filename = argv[2];
+
+    /* Open files. */
+    infile = fopen(in_filename, "rb");
+    if (! infile)
+    {
+        fprintf(stderr, "Couldn't open %s for reading.\n", in_filename);
+        return EXIT_FAILURE;
+    }
+    if (!logz_open_reader(&reader, infile))
+    {
+        fprintf(stderr, "%s is not a compressed log.\n", in_filename);
+        logz_close_reader(&reader);
+        fclose(infile);
+        return EXIT_FAILURE;
+    }
+    outfile = fopen(out_filename, "w");
+    if (! outfile)
+    {
+        fprintf(stderr, "Couldn't open %s for writing.\n", out_filename);
+        logz_close_reader(&reader);
+        fclose(infile);
+        return EXIT_FAILURE;
+    }
+
+    /* Decode one frame at a time, exactly as write_list prints them. */
+    grid = create_map(reader.height, reader.width);
+    first_map_written = false;
+    while ((status = logz_read_frame(&reader, grid)) == LOGZ_FRAME)
+    {
+        if (first_map_written)
+        {
+            write_separator(reader.width, outfile);
+        }
+        write_map(grid, reader.height, reader.width, outfile);
+        first_map_written = true;
+    }
+
+    /* Clean up. */
+    delete_map(grid, reader.height);
+    logz_close_reader(&reader);
+    fclose(outfile);
+    fclose(infile);
+
+    /* The frames before the damage are kept, but it is not a success. */
+    if (status == LOGZ_ERROR)
+    {
+        fprintf(stderr, "%s is truncated or corrupt; %s holds the frames before that.\n",
+        in_filename, out_filename);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
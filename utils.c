@@ -1,10 +1,9 @@
 #include "utils.h"
 #include <stdbool.h>
-#include "linkedlist.h"
 #include <stdlib.h>
 #include <assert.h>
 #include "colors.h"
-#include "sleep.h"
+#include "trace.h"
 
 char** create_map(int height, int width)
 {
@@ -21,11 +20,9 @@ char** create_map(int height, int width)
     return grid;
 }
 
-void initialize_map(char** grid, int height, int width, FILE* map)
+void initialize_map(char** grid, int height, int width, FILE* map,
+pos_t* player_pos, pos_t* enemy_pos)
 {
-    extern pos_t player_pos;
-    extern pos_t enemy_pos;
-
     /* Declare variable to read position and direction. */
     int x, y;
     char dir;
@@ -49,16 +46,16 @@ void initialize_map(char** grid, int height, int width, FILE* map)
     fscanf(map, "%d%d", &x, &y);
     fscanf(map, " %c", &dir);
     grid[x][y] = get_player(dir);
-    player_pos.x = x;
-    player_pos.y = y;
+    player_pos->x = x;
+    player_pos->y = y;
 
     /* Read enemy data. */
     fscanf(map, "%d%d", &x, &y);
     fscanf(map, " %c", &dir);
     grid[x][y] = get_player(dir);   /* As enemy tank is represented 
                                     with same symbol as the symbol of player. */
-    enemy_pos.x = x;
-    enemy_pos.y = y;
+    enemy_pos->x = x;
+    enemy_pos->y = y;
 
     /* As long as there are mirrors in input file. */
     while ((status = fscanf(map, "%d%d %c", &x, &y, &dir)) != EOF)
@@ -174,27 +171,12 @@ char** get_copy(char** grid, int height, int width)
     return new_grid;
 }
 
-char menu()
-{
-    char choice;
-    do {
-        fprintf(stdout, "w to go/face up\n");
-        fprintf(stdout, "s to go/face down\n");
-        fprintf(stdout, "a to go/face left\n");
-        fprintf(stdout, "d to go/face right\n");
-        fprintf(stdout, "f to shoot laser\n");
-        fprintf(stdout, "l to save the log\n");
-        fprintf(stdout, "action: ");
-        fscanf(stdin, " %c", &choice);
-    } while (choice != 'w' && choice != 's' && choice != 'a' && choice != 'd'
-    && choice != 'f' && choice != 'l');
-    return choice;
-}
-
 void write_map(char** grid, int height, int width, FILE* stream)
 {
     /* Loop counter variables. */
     int i, j;
+
+    TRACE_BEGIN("write_map");
     
     /* Print top border. */
     for (j = 0; j < width + 2; j++)
@@ -240,351 +222,57 @@ void write_map(char** grid, int height, int width, FILE* stream)
         fprintf(stream, "*");
     }
     fprintf(stream, "\n");
-}
-
-void enemy_fire(bool* exit_flag, char** grid, int height, int width)
-{
-    extern node_t* game_log;
-    extern pos_t enemy_pos;
-    extern pos_t player_pos;
-    extern unsigned SLEEP_DURATION;
-
-    /* Laser vector. */
-    pos_t laser_pos;
-    char laser_dir;
-
-    /* Initial position of the laser. */
-    laser_pos.x = enemy_pos.x;
-    laser_pos.y = enemy_pos.y;
-
-    /* Initial direction of the laser. */
-    laser_dir = get_player_dir(grid[enemy_pos.x][enemy_pos.y]);
-
-    /* Laser loop. */
-    while (true)
-    {
-        /* Advance. */
-        if (laser_dir == 'u')
-        {
-            laser_pos.x--;
-        }
-        else if (laser_dir == 'd')
-        {
-            laser_pos.x++;
-        }
-        else if (laser_dir == 'l')
-        {
-            laser_pos.y--;
-        }
-        else if (laser_dir == 'r')
-        {
-            laser_pos.y++;
-        }
-
-        /* If laser is out of bounds, break. */
-        if (laser_pos.x < 0 || laser_pos.x >= height 
-        || laser_pos.y < 0 || laser_pos.y >= width)
-        {
-            break;
-        }
-
-        /* If laser hits the mirror, change direction. */
-        if (is_mirror(grid[laser_pos.x][laser_pos.y]))
-        {
-            /* Get mirror direction: (forward or backward slash) */
-            char mirror_dir;
-            mirror_dir = get_mirror_dir(grid[laser_pos.x][laser_pos.y]);
-
-            /* Forward mirror. */
-            if (mirror_dir == 'f')
-            {
-                /* Change final laser direction based on its initial direction. */
-                if (laser_dir == 'd') laser_dir = 'l';
-                else if (laser_dir == 'u') laser_dir = 'r';
-                else if (laser_dir == 'r') laser_dir = 'u';
-                else if (laser_dir == 'l') laser_dir = 'd';
-            }
-            /* Backward mirror. */
-            else if (mirror_dir == 'b')
-            {
-                if (laser_dir == 'd') laser_dir = 'r';
-                else if (laser_dir == 'u') laser_dir = 'l';
-                else if (laser_dir == 'r') laser_dir = 'd';
-                else if (laser_dir == 'l') laser_dir = 'u';
-            }
-        }
-
-        /* If laser hits the player tank, declare lose and exit. */
-        else if (laser_pos.x == player_pos.x && laser_pos.y == player_pos.y)
-        {
-            fprintf(stdout, "You lose!\n");
-            *exit_flag = true;
-            break;
-        }
-        else
-        {
-            /* The laser is inside the grid, it didn't hit a mirror, and
-            and it didn't hit a player tank. */
 
-            /* Print laser beam. */
-            if (laser_dir == 'u' || laser_dir == 'd')
-            {
-                grid[laser_pos.x][laser_pos.y] = '|';
-            }
-            else
-            {
-                grid[laser_pos.x][laser_pos.y] = '-';
-            }
-            system("clear");
-            write_map(grid, height, width, stdout);
-            
-            /* Log game. */
-            insert_last(&game_log, grid, height, width);
-            
-            msleep(SLEEP_DURATION);
-            grid[laser_pos.x][laser_pos.y] = ' ';
-        }
-    }
+    TRACE_END("write_map");
 }
 
-void player_fire(bool* exit_flag, char** grid, int height, int width)
+void advance_laser(pos_t* laser_pos, char laser_dir)
 {
-    extern node_t* game_log;
-    extern pos_t enemy_pos;
-    extern pos_t player_pos;
-    extern unsigned SLEEP_DURATION;
-
-    /* Laser vector. */
-    pos_t laser_pos;
-    char laser_dir;
-
-    /* Initial position of the laser. */
-    laser_pos.x = player_pos.x;
-    laser_pos.y = player_pos.y;
-
-    /* Initial direction of the laser. */
-    laser_dir = get_player_dir(grid[player_pos.x][player_pos.y]);
-
-    /* Laser loop. */
-    while (true)
+    if (laser_dir == 'u')
     {
-        /* Advance. */
-        if (laser_dir == 'u')
-        {
-            laser_pos.x--;
-        }
-        else if (laser_dir == 'd')
-        {
-            laser_pos.x++;
-        }
-        else if (laser_dir == 'l')
-        {
-            laser_pos.y--;
-        }
-        else if (laser_dir == 'r')
-        {
-            laser_pos.y++;
-        }
-
-        /* If laser is out of bounds, break. */
-        if (laser_pos.x < 0 || laser_pos.x >= height 
-        || laser_pos.y < 0 || laser_pos.y >= width)
-        {
-            break;
-        }
-
-        /* If laser hits the mirror, change direction. */
-        if (is_mirror(grid[laser_pos.x][laser_pos.y]))
-        {
-            /* Get mirror direction: (forward or backward slash) */
-            char mirror_dir;
-            mirror_dir = get_mirror_dir(grid[laser_pos.x][laser_pos.y]);
-
-            /* Forward mirror. */
-            if (mirror_dir == 'f')
-            {
-                /* Change final laser direction based on its initial direction. */
-                if (laser_dir == 'd') laser_dir = 'l';
-                else if (laser_dir == 'u') laser_dir = 'r';
-                else if (laser_dir == 'r') laser_dir = 'u';
-                else if (laser_dir == 'l') laser_dir = 'd';
-            }
-            /* Backward mirror. */
-            else if (mirror_dir == 'b')
-            {
-                if (laser_dir == 'd') laser_dir = 'r';
-                else if (laser_dir == 'u') laser_dir = 'l';
-                else if (laser_dir == 'r') laser_dir = 'd';
-                else if (laser_dir == 'l') laser_dir = 'u';
-            }
-        }
-
-        /* If laser hits the enemy tank, declare win and exit. */
-        else if (laser_pos.x == enemy_pos.x && laser_pos.y == enemy_pos.y)
-        {
-            fprintf(stdout, "You win!\n");
-            *exit_flag = true;
-            break;
-        }
-        else
-        {
-            /* The laser is inside the grid, it didn't hit a mirror, and
-            and it didn't hit an enemy tank. */
-
-            /* Print laser beam. */
-            if (laser_dir == 'u' || laser_dir == 'd')
-            {
-                grid[laser_pos.x][laser_pos.y] = '|';
-            }
-            else
-            {
-                grid[laser_pos.x][laser_pos.y] = '-';
-            }
-            system("clear");
-            write_map(grid, height, width, stdout);
-            
-            /* Log game. */
-            insert_last(&game_log, grid, height, width);
-            
-            msleep(SLEEP_DURATION);
-            grid[laser_pos.x][laser_pos.y] = ' ';
-        }
+        laser_pos->x--;
     }
-}
-
-bool in_line_of_sight(pos_t player_pos, pos_t enemy_pos, char** grid)
-{
-    if (player_pos.x == enemy_pos.x)
+    else if (laser_dir == 'd')
     {
-        /* Player is in the horizontal line of sight of the enemy tank. */
-        char enemy_dir;
-        enemy_dir = get_player_dir(grid[enemy_pos.x][enemy_pos.y]);
-        if ((enemy_dir == 'r' && enemy_pos.y < player_pos.y) ||
-        (enemy_dir == 'l' && player_pos.y < enemy_pos.y))
-        {
-            /* Enemy fires. */
-            return true;
-        }
+        laser_pos->x++;
     }
-    else if (player_pos.y == enemy_pos.y)
+    else if (laser_dir == 'l')
     {
-        /* Player is in the vertical line of sight of the enemy tank. */
-        char enemy_dir;
-        enemy_dir = get_player_dir(grid[enemy_pos.x][enemy_pos.y]);
-        if ((enemy_dir == 'u' && player_pos.x < enemy_pos.x) ||
-        (enemy_dir == 'd' && enemy_pos.x < player_pos.x))
-        {
-            /* Enemy fires. */
-            return true;
-        }
+        laser_pos->y--;
     }
-    return false;
-}
-
-void go_or_face_upward(char** grid)
-{
-    extern pos_t player_pos;
-
-    /* If the player is not already facing upward. */
-    if (get_player_dir(grid[player_pos.x][player_pos.y]) != 'u')
+    else if (laser_dir == 'r')
     {
-        /* Face upward. */
-        grid[player_pos.x][player_pos.y] = get_player('u');
-    }
-    /* Attemp to move one step upward. */
-    else
-    {
-        /* The player cannot go to the same position as that of the mirror. */
-        /* The player cannot go out of the boundary of the map. */
-        if (player_pos.x - 1 >= 0 && 
-        !is_mirror(grid[player_pos.x - 1][player_pos.y]) &&
-        !is_player(grid[player_pos.x - 1][player_pos.y]))
-        {
-            /* Move the player one step upward. */
-            grid[player_pos.x - 1][player_pos.y] = grid[player_pos.x][player_pos.y];
-            grid[player_pos.x][player_pos.y] = ' ';
-            player_pos.x--;
-        }
+        laser_pos->y++;
     }
 }
 
-void go_or_face_downward(char** grid, int height)
+char reflect_laser(char laser_dir, char mirror)
 {
-    extern pos_t player_pos;
+    /* Get mirror direction: (forward or backward slash) */
+    char mirror_dir;
+    mirror_dir = get_mirror_dir(mirror);
 
-    /* If the player is not already facing downward. */
-    if (get_player_dir(grid[player_pos.x][player_pos.y]) != 'd')
+    /* Forward mirror. */
+    if (mirror_dir == 'f')
     {
-        /* Face downward. */
-        grid[player_pos.x][player_pos.y] = get_player('d');
+        /* Change final laser direction based on its initial direction. */
+        if (laser_dir == 'd') return 'l';
+        else if (laser_dir == 'u') return 'r';
+        else if (laser_dir == 'r') return 'u';
+        else if (laser_dir == 'l') return 'd';
     }
-    /* Attemp to move one step downward. */
-    else
+    /* Backward mirror. */
+    else if (mirror_dir == 'b')
     {
-        /* The player cannot go to the same position as that of the mirror. */
-        /* The player cannot go out of the boundary of the map. */
-        if (player_pos.x + 1 < height &&
-        !is_mirror(grid[player_pos.x + 1][player_pos.y]) &&
-        !is_player(grid[player_pos.x + 1][player_pos.y]))
-        {
-            /* Move the player one step downward. */
-            grid[player_pos.x + 1][player_pos.y] = grid[player_pos.x][player_pos.y];
-            grid[player_pos.x][player_pos.y] = ' ';
-            player_pos.x++;
-        }
+        if (laser_dir == 'd') return 'r';
+        else if (laser_dir == 'u') return 'l';
+        else if (laser_dir == 'r') return 'd';
+        else if (laser_dir == 'l') return 'u';
     }
+    return laser_dir;
 }
 
-void go_or_face_rightward(char** grid, int width)
+char get_laser(char laser_dir)
 {
-    extern pos_t player_pos;
-
-    /* If the player is not already facing rightward. */
-    if (get_player_dir(grid[player_pos.x][player_pos.y]) != 'r')
-    {
-        /* Face rightward. */
-        grid[player_pos.x][player_pos.y] = get_player('r');
-    }
-    /* Attemp to move one step rightward. */
-    else
-    {
-        /* The player cannot go to the same position as that of the mirror. */
-        /* The player cannot go out of the boundary of the map. */
-        if (player_pos.y + 1 < width &&
-        !is_mirror(grid[player_pos.x][player_pos.y + 1]) &&
-        !is_player(grid[player_pos.x][player_pos.y + 1]))
-        {
-            /* Move the player one step rightward. */
-            grid[player_pos.x][player_pos.y + 1] = grid[player_pos.x][player_pos.y];
-            grid[player_pos.x][player_pos.y] = ' ';
-            player_pos.y++;
-        }
-    }
-}
-
-void go_or_face_leftward(char** grid)
-{
-    extern pos_t player_pos;
-
-    /* If the player is not already facing leftward. */
-    if (get_player_dir(grid[player_pos.x][player_pos.y]) != 'l')
-    {
-        /* Face leftward. */
-        grid[player_pos.x][player_pos.y] = get_player('l');
-    }
-    /* Attemp to move one step leftward. */
-    else
-    {
-        /* The player cannot go to the same position as that of the mirror. */
-        /* The player cannot go out of the boundary of the map. */
-        if (player_pos.y - 1 >= 0 &&
-        !is_mirror(grid[player_pos.x][player_pos.y - 1]) && 
-        !is_player(grid[player_pos.x][player_pos.y - 1]))
-        {
-            /* Move the player one step leftward. */
-            grid[player_pos.x][player_pos.y - 1] = grid[player_pos.x][player_pos.y];
-            grid[player_pos.x][player_pos.y] = ' ';
-            player_pos.y--;
-        }
-    }
+    return (laser_dir == 'u' || laser_dir == 'd') ? '|' : '-';
 }
@@ -66,8 +66,11 @@ char** get_copy(char** grid, int height, int width);
  * @param grid pointer to the 2D array representing the map.
  * @param height number of rows in the map.
  * @param width number of columns in the map. 
- * @param map file pointer for the input file. */
-void initialize_map(char** grid, int height, int width, FILE* map);
+ * @param map file pointer for the input file.
+ * @param player_pos receives the position of the player tank.
+ * @param enemy_pos receives the position of the enemy tank. */
+void initialize_map(char** grid, int height, int width, FILE* map,
+pos_t* player_pos, pos_t* enemy_pos);
 
 /** Writes a map to the a file stream. 
  * @param grid pointer to the 2D array of characters representing a map.
@@ -76,58 +79,19 @@ void initialize_map(char** grid, int height, int width, FILE* map);
  * @param stream file stream where the map is to be written. */
 void write_map(char** grid, int height, int width, FILE* stream);
 
-/** This function is called when the player is in the line of sight
- * of the enemy tank. 
- * @param exit_flag exit flag of the program.
- * @param grid pointer to the 2D array of character representing map.
- * @param height number of rows in the grid.
- * @param width number of columns in the grid. /*/
-void enemy_fire(bool* exit_flag, char** grid, int height, int width);
+/** Advances a laser one step in a given direction.
+ * @param laser_pos position of the laser, updated in place.
+ * @param laser_dir direction of the laser (u/d/l/r). */
+void advance_laser(pos_t* laser_pos, char laser_dir);
 
-/** This function is called when the player is in the line of sight
- * of the enemy tank. 
- * @param exit_flag exit flag of the program.
- * @param grid pointer to the 2D array of character representing map.
- * @param height number of rows in the grid.
- * @param width number of columns in the grid. /*/
-void player_fire(bool* exit_flag, char** grid, int height, int width);
-
-/** Returns true if the player is in the line of sight of the enemy tank.
- * return false otherwise. 
- * @param player_pos position of the player tank.
- * @param enemy_pos position of the enemy tank.
- * @param grid pointer to the 2D array of characters representing the map.
- * @return true if player is in line of sight of the enemy tank,
- * returns false otherwise.*/
-bool in_line_of_sight(pos_t player_pos, pos_t enemy_pos, char** grid);
-
-/** Attemps to make the player face to go one step upward. 
- * @param grid pointer to the 2D array of characters representing the map. */
-void go_or_face_upward(char** grid);
-
-/** Attemps to make the player face to go one step upward. 
- * @param grid pointer to the 2D array of characters representing map.
- * @param height number of rows in the grid. */
-void go_or_face_downward(char** grid, int height);
-
-/** Attemps to make the player face to go one step rightward.
- * @param grid pointer to the 2D array of characters representing the map. 
- * @param width number of columns in the grid. */
-void go_or_face_rightward(char** grid, int width);
-
-/** Attemps to make the player face to go one step leftward. 
- * @param grid pointer to the 2D array of characters representing the map. */
-void go_or_face_leftward(char** grid);
-
-/** Gets a valid menu choice from the user. 
- * @return character representation of the menu choice.
- * 
- * w: to move upward.
- * a: to move leftward.
- * s: to move downward.
- * d: to move rightward.
- * f: to fire.
- * l: to save game log. */
-char menu();
+/** Returns the direction of a laser after it hits a mirror.
+ * @param laser_dir direction of the laser before the hit (u/d/l/r).
+ * @param mirror character representation of the mirror.
+ * @return direction of the laser after the hit. */
+char reflect_laser(char laser_dir, char mirror);
+
+/** Returns the character representation of a laser beam travelling
+ * in a given direction. */
+char get_laser(char laser_dir);
 
 #endif  /* UTILS_H */
\ No newline at end of file
@@ -0,0 +1,285 @@
+#define _POSIX_C_SOURCE 200809L
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "mapcheck.h"
+#include "sleep.h"
+#include "utils.h"
+
+/* Problems reported per file unless --max-errors says otherwise. */
+#define DEFAULT_MAX_ERRORS 20
+
+/* Defines the result of checking one map file. Problems are kept as text,
+one "file:line:column: message" line each, and printed in argument order
+once all threads are joined. */
+typedef struct
+{
+    const char* filename;
+    char* report;
+    size_t report_size;
+    size_t report_capacity;
+    size_t bytes;
+    int errors;
+} result_t;
+
+/* Defines the shared work list: threads take the next file by bumping
+next until it reaches count. */
+typedef struct
+{
+    result_t* results;
+    int count;
+    int next;
+    int max_errors;
+} work_t;
+
+/* Defines one thread and the buffer it reads files into. */
+typedef struct
+{
+    pthread_t thread;
+    work_t* work;
+    char* buffer;
+    size_t capacity;
+} worker_t;
+
+/* Prints the usage of the program. */
+static void usage(const char* program)
+{
+    fprintf(stderr, "Usage: %s [--threads <n>] [--max-errors <n>] %s\n",
+    program, "<map-filename>...");
+}
+
+/* Reads a whole argument as a number of at least 1 into value. Returns
+false, leaving value as it was, if the argument is anything else. */
+static bool parse_positive(const char* text, int* value)
+{
+    char* end;
+    long number;
+
+    number = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || number < 1 || number > INT_MAX)
+    {
+        return false;
+    }
+    *value = (int) number;
+    return true;
+}
+
+/* Appends a formatted line to the report of a file. */
+static void add_line(result_t* result, const char* text)
+{
+    size_t length;
+
+    length = strlen(text);
+    if (result->report_size + length + 1 > result->report_capacity)
+    {
+        result->report_capacity = (result->report_size + length + 1) * 2;
+        result->report = realloc(result->report, result->report_capacity);
+    }
+    memcpy(result->report + result->report_size, text, length + 1);
+    result->report_size += length;
+}
+
+/* Records a problem found by check_map in the result given as context. */
+static void record(int line, int column, const char* message, void* context)
+{
+    result_t* result;
+    char text[4096 + 256];
+
+    result = context;
+    snprintf(text, sizeof(text), "%s:%d:%d: %s\n", result->filename, line, column, message);
+    add_line(result, text);
+}
+
+/* Reads a whole file into the worker's buffer. Returns false with a
+message in the result if it can't. */
+static bool read_file(worker_t* worker, result_t* result)
+{
+    char text[4096 + 64];
+    struct stat info;
+    ssize_t count;
+    int fd;
+
+    fd = open(result->filename, O_RDONLY);
+    if (fd < 0)
+    {
+        snprintf(text, sizeof(text), "Couldn't open %s for reading.\n", result->filename);
+        add_line(result, text);
+        return false;
+    }
+    if (fstat(fd, &info) == 0 && (size_t) info.st_size + 1 > worker->capacity)
+    {
+        worker->capacity = (size_t) info.st_size + 1;
+        worker->buffer = realloc(worker->buffer, worker->capacity);
+    }
+
+    /* Read to the end rather than trusting the size. */
+    result->bytes = 0;
+    while ((count = read(fd, worker->buffer + result->bytes,
+    worker->capacity - result->bytes)) > 0)
+    {
+        result->bytes += (size_t) count;
+        if (result->bytes == worker->capacity)
+        {
+            worker->capacity *= 2;
+            worker->buffer = realloc(worker->buffer, worker->capacity);
+        }
+    }
+    close(fd);
+    if (count < 0)
+    {
+        snprintf(text, sizeof(text), "Couldn't read %s.\n", result->filename);
+        add_line(result, text);
+        return false;
+    }
+    return true;
+}
+
+/* Checks files from the work list until there are none left. */
+static void* run_worker(void* arg)
+{
+    worker_t* worker;
+    work_t* work;
+    int k;
+
+    worker = arg;
+    work = worker->work;
+    while ((k = __atomic_fetch_add(&work->next, 1, __ATOMIC_RELAXED)) < work->count)
+    {
+        result_t* result;
+
+        result = &work->results[k];
+        if (!read_file(worker, result))
+        {
+            result->errors = 1;
+            continue;
+        }
+        result->errors = check_map(worker->buffer, result->bytes, work->max_errors,
+        record, result);
+    }
+    return NULL;
+}
+
+/* Checks map files in parallel and reports every problem found in them. */
+int main(int argc, char** argv)
+{
+    int threads;
+    work_t work;
+    worker_t* workers;
+    long invalid;
+    size_t total_bytes;
+    long long start, elapsed;
+    double seconds;
+    int first_map;
+    int started;
+    int i, t;
+
+    threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    work.max_errors = DEFAULT_MAX_ERRORS;
+
+    /* Parse options. */
+    for (i = 1; i < argc && strncmp(argv[i], "--", 2) == 0; i += 2)
+    {
+        if (i + 1 >= argc)
+        {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        if (strcmp(argv[i], "--threads") == 0 && parse_positive(argv[i + 1], &threads))
+        {
+            continue;
+        }
+        if (strcmp(argv[i], "--max-errors") == 0
+        && parse_positive(argv[i + 1], &work.max_errors))
+        {
+            continue;
+        }
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    first_map = i;
+    if (first_map >= argc)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (threads <= 0)
+    {
+        threads = 1;
+    }
+
+    work.count = argc - first_map;
+    work.next = 0;
+    work.results = calloc(work.count, sizeof(result_t));
+    for (i = 0; i < work.count; i++)
+    {
+        work.results[i].filename = argv[first_map + i];
+    }
+    if (threads > work.count)
+    {
+        threads = work.count;
+    }
+
+    /* Check. */
+    start = usec_now();
+    workers = calloc(threads, sizeof(worker_t));
+    for (t = 0; t < threads; t++)
+    {
+        workers[t].work = &work;
+        workers[t].capacity = 4096;
+        workers[t].buffer = malloc(workers[t].capacity);
+    }
+    for (started = 0; started < threads; started++)
+    {
+        if (pthread_create(&workers[started].thread, NULL, run_worker, &workers[started]) != 0)
+        {
+            break;
+        }
+    }
+    if (started < threads)
+    {
+        /* Check what the missing threads would have on this one. */
+        fprintf(stderr, "Couldn't start more than %d thread(s).\n", started);
+        run_worker(&workers[started]);
+    }
+    for (t = 0; t < started; t++)
+    {
+        pthread_join(workers[t].thread, NULL);
+    }
+    for (t = 0; t < threads; t++)
+    {
+        free(workers[t].buffer);
+    }
+    if (started < threads)
+    {
+        threads = started + 1;
+    }
+    elapsed = usec_now() - start;
+
+    /* Report in argument order. */
+    invalid = 0;
+    total_bytes = 0;
+    for (i = 0; i < work.count; i++)
+    {
+        if (work.results[i].errors > 0)
+        {
+            fputs(work.results[i].report, stdout);
+            invalid++;
+        }
+        total_bytes += work.results[i].bytes;
+        free(work.results[i].report);
+    }
+    seconds = elapsed > 0 ? elapsed / 1e6 : 1e-6;
+    fprintf(stderr, "%d file(s), %ld valid, %ld invalid, %.1f MB in %.3f s "
+    "(%.0f files/s, %.1f MB/s) on %d thread(s)\n", work.count, work.count - invalid,
+    invalid, total_bytes / 1e6, elapsed / 1e6, work.count / seconds,
+    total_bytes / 1e6 / seconds, threads);
+
+    free(workers);
+    free(work.results);
+    return invalid == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,191 @@
+#define _POSIX_C_SOURCE 200809L
+#include "viewport.h"
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include "colors.h"
+#include "killmap.h"
+#include "trace.h"
+
+/* Terminal rows left for the menu printed below the map. */
+#define MENU_ROWS 8
+
+/* Maximum size of the minimap, not counting its border. */
+#define MINIMAP_ROWS 6
+#define MINIMAP_COLS 32
+
+/* Cells sampled along each axis of a minimap block to look for mirrors. */
+#define MINIMAP_SAMPLES 4
+
+bool terminal_size(FILE* stream, int* rows, int* cols)
+{
+    struct winsize size;
+    if (!isatty(fileno(stream)) || ioctl(fileno(stream), TIOCGWINSZ, &size) != 0
+    || size.ws_row == 0 || size.ws_col == 0)
+    {
+        return false;
+    }
+    *rows = size.ws_row;
+    *cols = size.ws_col;
+    return true;
+}
+
+/* Clamps value to [low, high]. */
+static int clamp(int value, int low, int high)
+{
+    return value < low ? low : (value > high ? high : value);
+}
+
+/* Writes a row of n border characters. */
+static void write_border(int n, char c, FILE* stream)
+{
+    int j;
+    for (j = 0; j < n; j++)
+    {
+        fputc(c, stream);
+    }
+    fputc('\n', stream);
+}
+
+/* Draws rows [top, top + rows) and columns [left, left + cols) of a map in
+a frame of '*', with the laser beams and the kill map overlay in color. */
+static void write_window(char** grid, int height, int width, int top, int left,
+int rows, int cols, FILE* stream)
+{
+    int i, j;
+
+    write_border(cols + 2, '*', stream);
+    for (i = top; i < top + rows; i++)
+    {
+        fputc('*', stream);
+        for (j = left; j < left + cols; j++)
+        {
+            char grid_cell;
+            grid_cell = grid[i][j];
+
+            /* If the grid cell has a laser beam, write it with color. */
+            if (grid_cell == '|' || grid_cell == '-')
+            {
+                fprintf(stream, FRED("%c"), grid_cell);
+            }
+            /* Mark the firing positions of the kill map overlay. */
+            else if ((grid_cell == ' ' || is_player(grid_cell))
+            && kill_overlay_marks(height, width, i, j))
+            {
+                fprintf(stream, FGRN("%c"), grid_cell == ' ' ? '.' : grid_cell);
+            }
+            else
+            {
+                fputc(grid_cell, stream);
+            }
+        }
+        fputs("*\n", stream);
+    }
+    write_border(cols + 2, '*', stream);
+}
+
+/* Draws a summary of the whole map: T for tanks, : for blocks with mirrors
+and + for empty blocks inside the viewport. Mirrors are sampled rather than
+counted so the cost stays bounded by the size of the minimap. */
+static void write_minimap(char** grid, int height, int width, int top, int left,
+int view_rows, int view_cols, int mm_rows, int mm_cols, pos_t player_pos,
+pos_t enemy_pos, FILE* stream)
+{
+    int i, j;
+
+    write_border(mm_cols + 2, '#', stream);
+    for (i = 0; i < mm_rows; i++)
+    {
+        int row_begin, row_end;
+        row_begin = (int) ((long) i * height / mm_rows);
+        row_end = (int) ((long) (i + 1) * height / mm_rows);
+
+        fputc('#', stream);
+        for (j = 0; j < mm_cols; j++)
+        {
+            int col_begin, col_end;
+            char c;
+            int si, sj;
+
+            col_begin = (int) ((long) j * width / mm_cols);
+            col_end = (int) ((long) (j + 1) * width / mm_cols);
+
+            /* Blocks inside the viewport stand out. */
+            c = (row_begin < top + view_rows && top < row_end
+            && col_begin < left + view_cols && left < col_end) ? '+' : ' ';
+
+            /* Look for mirrors at a few evenly spread cells. */
+            for (si = 0; si < MINIMAP_SAMPLES && c != ':'; si++)
+            {
+                int x;
+                x = row_begin + (row_end - row_begin) * si / MINIMAP_SAMPLES;
+                for (sj = 0; sj < MINIMAP_SAMPLES; sj++)
+                {
+                    int y;
+                    y = col_begin + (col_end - col_begin) * sj / MINIMAP_SAMPLES;
+                    if (is_mirror(grid[x][y]))
+                    {
+                        c = ':';
+                        break;
+                    }
+                }
+            }
+
+            /* Tanks win over anything else. */
+            if ((player_pos.x >= row_begin && player_pos.x < row_end
+            && player_pos.y >= col_begin && player_pos.y < col_end)
+            || (enemy_pos.x >= row_begin && enemy_pos.x < row_end
+            && enemy_pos.y >= col_begin && enemy_pos.y < col_end))
+            {
+                c = 'T';
+            }
+            fputc(c, stream);
+        }
+        fputs("#\n", stream);
+    }
+    write_border(mm_cols + 2, '#', stream);
+}
+
+void draw_view(char** grid, int height, int width, pos_t focus, pos_t player,
+pos_t enemy, FILE* stream)
+{
+    int rows, cols;
+    int view_rows, view_cols;
+    int mm_rows, mm_cols;
+    int top, left;
+
+    TRACE_BEGIN("draw_view");
+
+    /* Draw small maps, and maps not drawn on a terminal, whole. */
+    if (!terminal_size(stream, &rows, &cols)
+    || (height + 2 + MENU_ROWS <= rows && width + 2 <= cols))
+    {
+        write_window(grid, height, width, 0, 0, height, width, stream);
+        TRACE_END("draw_view");
+        return;
+    }
+
+    /* Share the rows between the viewport, a status line and the minimap. */
+    mm_rows = height < MINIMAP_ROWS ? height : MINIMAP_ROWS;
+    mm_cols = width < MINIMAP_COLS ? width : MINIMAP_COLS;
+    if (mm_cols > cols - 2)
+    {
+        mm_cols = cols - 2 > 1 ? cols - 2 : 1;
+    }
+    view_rows = clamp(rows - MENU_ROWS - 2 - 1 - (mm_rows + 2), 1, height);
+    view_cols = clamp(cols - 2, 1, width);
+
+    /* Center the viewport on the focus cell, but keep it inside the map. */
+    top = clamp(focus.x - view_rows / 2, 0, height - view_rows);
+    left = clamp(focus.y - view_cols / 2, 0, width - view_cols);
+
+    /* Draw the viewport, framed like write_map frames the whole map. */
+    write_window(grid, height, width, top, left, view_rows, view_cols, stream);
+
+    /* Status line and minimap. */
+    fprintf(stream, "rows %d-%d of %d, columns %d-%d of %d\n",
+    top + 1, top + view_rows, height, left + 1, left + view_cols, width);
+    write_minimap(grid, height, width, top, left, view_rows, view_cols,
+    mm_rows, mm_cols, player, enemy, stream);
+
+    TRACE_END("draw_view");
+}
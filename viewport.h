@@ -0,0 +1,30 @@
+#ifndef VIEWPORT_H
+#define VIEWPORT_H
+#include <stdio.h>
+#include <stdbool.h>
+#include "utils.h"
+
+/** Gets the size of the terminal a stream writes to.
+ * @param stream file stream connected to the terminal.
+ * @param rows receives the number of rows of the terminal.
+ * @param cols receives the number of columns of the terminal.
+ * @return true on success, false if stream is not a terminal. */
+bool terminal_size(FILE* stream, int* rows, int* cols);
+
+/** Draws a map on a terminal.
+ * A map which fits in the terminal is drawn whole, framed like write_map
+ * frames it, with the kill map overlay if one is set. A larger one is drawn through a
+ * viewport centered (as far as the map allows) on a focus cell, followed
+ * by a minimap of the whole map, so that the cost of a frame depends on
+ * the size of the terminal rather than on the size of the map.
+ * @param grid pointer to the 2D array of characters representing a map.
+ * @param height number of rows in the grid.
+ * @param width number of columns in the grid.
+ * @param focus cell to keep in view, e.g. the player or a laser beam.
+ * @param player position of the player tank, shown on the minimap.
+ * @param enemy position of the enemy tank, shown on the minimap.
+ * @param stream file stream where the map is to be drawn. */
+void draw_view(char** grid, int height, int width, pos_t focus, pos_t player,
+pos_t enemy, FILE* stream);
+
+#endif  /* VIEWPORT_H */
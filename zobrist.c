@@ -0,0 +1,48 @@
+#include "zobrist.h"
+#include "broadcast.h"
+
+unsigned long long grid_hash = 0;
+
+unsigned long long cell_key(int x, int y, char c)
+{
+    unsigned long long z;
+
+    if (c == ' ')
+    {
+        return 0;
+    }
+
+    /* SplitMix64 finalizer of the packed cell. */
+    z = ((unsigned long long) (unsigned) x << 40) ^ ((unsigned long long) (unsigned) y << 8)
+    ^ (unsigned char) c;
+    z += 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+unsigned long long hash_grid(char** grid, int height, int width)
+{
+    unsigned long long hash;
+    int i, j;
+
+    hash = 0;
+    for (i = 0; i < height; i++)
+    {
+        for (j = 0; j < width; j++)
+        {
+            hash ^= cell_key(i, j, grid[i][j]);
+        }
+    }
+    return hash;
+}
+
+void set_cell(char** grid, int x, int y, char c)
+{
+    grid_hash ^= cell_key(x, y, grid[x][y]) ^ cell_key(x, y, c);
+    grid[x][y] = c;
+    if (frame_broadcast)
+    {
+        note_changed_cell(frame_broadcast, x, y);
+    }
+}
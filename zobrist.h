@@ -0,0 +1,34 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+/* Zobrist hash of the game grid.
+ *
+ * The hash is the XOR of a pseudo-random key per non-blank cell, chosen by
+ * the position of the cell and its character. Changing a cell XORs its old
+ * key out and its new key in, so the movement and laser code keep the hash
+ * of the game grid up to date in constant time by changing cells through
+ * set_cell. Keys are computed from the position and character rather than
+ * looked up, so maps of any size need no table. */
+
+/** Hash of the game grid: set by initialize_map, updated by set_cell. */
+extern unsigned long long grid_hash;
+
+/** Returns the key of a character at a position; 0 for a blank cell. */
+unsigned long long cell_key(int x, int y, char c);
+
+/** Computes the hash of a whole grid.
+ * @param grid pointer to the 2D array of characters representing a map.
+ * @param height number of rows in the grid.
+ * @param width number of columns in the grid.
+ * @return XOR of the keys of all cells. */
+unsigned long long hash_grid(char** grid, int height, int width);
+
+/** Changes a cell of the game grid, updating grid_hash and noting the
+ * cell for frame_broadcast if set.
+ * @param grid pointer to the 2D array of characters representing the map.
+ * @param x row of the cell.
+ * @param y column of the cell.
+ * @param c new character of the cell. */
+void set_cell(char** grid, int x, int y, char c);
+
+#endif  /* ZOBRIST_H */